@@ -0,0 +1,34 @@
+#include "safe_stack/trace.h"
+#include <algorithm>
+#include <iostream>
+
+using namespace safe_stack;
+
+/// Converts binary trace written by safe_stack::trace to text.
+/// Usage: trace_decode <trace file>
+int main(int argc, char *argv[]) {
+    if (argc != 2) {
+        std::cerr << "Usage: " << argv[0] << " <trace file>\n";
+        return 1;
+    }
+
+    std::vector<trace::TraceRecord> records;
+    if (!trace::read(argv[1], records)) {
+        std::cerr << "Cannot read trace " << argv[1] << "\n";
+        return 1;
+    }
+
+    // threads are drained in batches, restore global order
+    std::stable_sort(records.begin(), records.end(),
+                     [](const auto &a, const auto &b) {
+                         return a.timestamp < b.timestamp;
+                     });
+    for (auto &record : records) {
+        std::cout << record.timestamp << " ns [thread " << record.thread
+                  << "] Stack 0x" << std::hex << record.stack << std::dec
+                  << ": " << logging::to_string(record.op) << " (size "
+                  << record.size << ", capacity " << record.capacity
+                  << ", hash " << record.hash << ")\n";
+    }
+    return 0;
+}
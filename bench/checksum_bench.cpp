@@ -0,0 +1,41 @@
+#include "safe_stack/crc32c.h"
+#include "safe_stack/safe_stack.h"
+#include "benchmark/benchmark.h"
+
+using namespace safe_stack;
+
+/// Pushes and pops `range(0)` elements with full checks and given hasher.
+template <class Hasher>
+static void BM_HasherPushPop(benchmark::State &state) {
+    Stack<int, std::allocator<int>, checks::Full, logging::None, Hasher> s;
+    auto count = static_cast<int>(state.range(0));
+    for (auto _ : state) {
+        for (int i = 0; i < count; ++i)
+            s.push(i);
+        for (int i = 0; i < count; ++i)
+            s.pop();
+    }
+    state.SetItemsProcessed(state.iterations() * count * 2);
+}
+
+BENCHMARK_TEMPLATE(BM_HasherPushPop, hashers::Byte)->Arg(1024);
+BENCHMARK_TEMPLATE(BM_HasherPushPop, hashers::Word32)->Arg(1024);
+BENCHMARK_TEMPLATE(BM_HasherPushPop, hashers::Word64)->Arg(1024);
+BENCHMARK_TEMPLATE(BM_HasherPushPop, hashers::Crc32c)->Arg(1024);
+
+/// Checks all elements of the stack with `range(0)` elements.
+template <class Policy>
+static void BM_DeepValidate(benchmark::State &state) {
+    Stack<int, std::allocator<int>, Policy> s;
+    for (int i = 0; i < state.range(0); ++i)
+        s.push(i);
+    for (auto _ : state)
+        s.deep_validate();
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+BENCHMARK_TEMPLATE(BM_DeepValidate, checks::WithPayload<checks::Full>)
+    ->Arg(1 << 20);
+BENCHMARK_TEMPLATE(BM_DeepValidate, checks::WithBlocks<checks::Full>)
+    ->Arg(1 << 20)
+    ->UseRealTime();
@@ -0,0 +1,47 @@
+#include "safe_stack/concurrent_stack.h"
+#include "benchmark/benchmark.h"
+#include <mutex>
+
+using namespace safe_stack;
+
+namespace {
+
+template <class Lock>
+using SharedStack =
+    ConcurrentStack<int, std::allocator<int>, checks::Full, Lock>;
+
+} // namespace
+
+/// Pushes and pops an element of the stack shared by all threads.
+template <class S>
+static void BM_SharedPushPop(benchmark::State &state) {
+    static S s;
+    int i = 0;
+    for (auto _ : state) {
+        s.push(i++);
+        benchmark::DoNotOptimize(s.try_pop());
+    }
+    state.SetItemsProcessed(state.iterations() * 2);
+}
+
+/// Reads the size of the stack shared by all threads (doesn't lock).
+template <class S>
+static void BM_SharedSize(benchmark::State &state) {
+    static S s;
+    if (state.thread_index() == 0)
+        s.push(42);
+    for (auto _ : state)
+        benchmark::DoNotOptimize(s.size());
+    if (state.thread_index() == 0)
+        s.clear();
+}
+
+BENCHMARK_TEMPLATE(BM_SharedPushPop, SharedStack<SpinLock>)
+    ->ThreadRange(1, 64)
+    ->UseRealTime();
+BENCHMARK_TEMPLATE(BM_SharedPushPop, SharedStack<std::mutex>)
+    ->ThreadRange(1, 64)
+    ->UseRealTime();
+BENCHMARK_TEMPLATE(BM_SharedSize, SharedStack<SpinLock>)
+    ->ThreadRange(1, 64)
+    ->UseRealTime();
@@ -0,0 +1,51 @@
+#include "safe_stack/growth.h"
+#include "safe_stack/safe_stack.h"
+#include "benchmark/benchmark.h"
+
+using namespace safe_stack;
+
+template <class Growth>
+using GrowthStack = Stack<int, std::allocator<int>, checks::None,
+                          logging::None, hashers::Word64, Growth>;
+
+/// Keeps `range(0)` elements in the stack, pushes and pops `range(1)` more.
+template <class Growth>
+static void BM_Oscillate(benchmark::State &state) {
+    GrowthStack<Growth> s;
+    auto base = static_cast<int>(state.range(0));
+    auto swing = static_cast<int>(state.range(1));
+    for (int i = 0; i < base; ++i)
+        s.push(i);
+    for (auto _ : state) {
+        for (int i = 0; i < swing; ++i)
+            s.push(i);
+        for (int i = 0; i < swing; ++i)
+            s.pop();
+    }
+    state.SetItemsProcessed(state.iterations() * swing * 2);
+}
+
+/// Pushes `range(0)` elements and pops all of them.
+template <class Growth>
+static void BM_FillDrain(benchmark::State &state) {
+    GrowthStack<Growth> s;
+    auto count = static_cast<int>(state.range(0));
+    for (auto _ : state) {
+        for (int i = 0; i < count; ++i)
+            s.push(i);
+        for (int i = 0; i < count; ++i)
+            s.pop();
+    }
+    state.SetItemsProcessed(state.iterations() * count * 2);
+}
+
+#define GROWTH_BENCHMARKS(Growth)                                              \
+    BENCHMARK_TEMPLATE(BM_Oscillate, Growth)                                   \
+        ->Args({400, 600})                                                     \
+        ->Args({40000, 60000});                                                \
+    BENCHMARK_TEMPLATE(BM_FillDrain, Growth)->Arg(1 << 10)->Arg(1 << 16)
+
+GROWTH_BENCHMARKS(growth::Legacy);
+GROWTH_BENCHMARKS(growth::Hysteresis);
+GROWTH_BENCHMARKS(growth::NeverShrink);
+GROWTH_BENCHMARKS(growth::ThreeHalves);
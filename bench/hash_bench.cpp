@@ -0,0 +1,29 @@
+#include "safe_stack/crc32c.h"
+#include "safe_stack/hash.h"
+#include "benchmark/benchmark.h"
+#include <vector>
+
+using namespace safe_stack;
+
+/// Hashes a buffer of `range(0)` bytes.
+template <class Hasher>
+static void BM_Hash(benchmark::State &state) {
+    std::vector<unsigned char> data(state.range(0), 42);
+    for (auto _ : state)
+        benchmark::DoNotOptimize(Hasher::hash(data.data(), data.size()));
+    state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+
+BENCHMARK_TEMPLATE(BM_Hash, hashers::Byte)->Arg(56)->Arg(4096);
+BENCHMARK_TEMPLATE(BM_Hash, hashers::Word32)->Arg(56)->Arg(4096);
+BENCHMARK_TEMPLATE(BM_Hash, hashers::Word64)->Arg(56)->Arg(4096);
+BENCHMARK_TEMPLATE(BM_Hash, hashers::Crc32c)->Arg(56)->Arg(4096);
+
+static void BM_Crc32cSoftware(benchmark::State &state) {
+    std::vector<unsigned char> data(state.range(0), 42);
+    for (auto _ : state)
+        benchmark::DoNotOptimize(crc32c_software(data.data(), data.size()));
+    state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+
+BENCHMARK(BM_Crc32cSoftware)->Arg(56)->Arg(4096);
@@ -0,0 +1,42 @@
+#include "safe_stack/segmented_stack.h"
+#include "benchmark/benchmark.h"
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+using namespace safe_stack;
+
+namespace {
+
+template <class S>
+void push(S &s, int value) {
+    s.push(value);
+}
+
+void push(std::vector<int> &s, int value) { s.push_back(value); }
+
+} // namespace
+
+/// Pushes `range(0)` elements to a new stack and reports the slowest push
+/// (the clock itself takes tens of nanoseconds).
+template <class S>
+static void BM_WorstPush(benchmark::State &state) {
+    using clock = std::chrono::steady_clock;
+    auto count = static_cast<int>(state.range(0));
+    clock::duration worst{0};
+    for (auto _ : state) {
+        S s;
+        for (int i = 0; i < count; ++i) {
+            auto start = clock::now();
+            push(s, i);
+            worst = std::max(worst, clock::now() - start);
+        }
+        benchmark::DoNotOptimize(&s);
+    }
+    state.counters["worst_push_ns"] =
+        std::chrono::duration<double, std::nano>(worst).count();
+}
+
+BENCHMARK_TEMPLATE(BM_WorstPush, std::vector<int>)->Arg(1 << 22);
+BENCHMARK_TEMPLATE(BM_WorstPush, Stack<int>)->Arg(1 << 22);
+BENCHMARK_TEMPLATE(BM_WorstPush, SegmentedStack<int>)->Arg(1 << 22);
@@ -0,0 +1,420 @@
+#include "safe_stack/guarded_allocator.h"
+#include "safe_stack/malloc_allocator.h"
+#include "safe_stack/mmap_allocator.h"
+#include "safe_stack/safe_stack.h"
+#include "safe_stack/scrubber.h"
+#include "safe_stack/segmented_stack.h"
+#include "safe_stack/static_stack.h"
+#include "safe_stack/virtual_allocator.h"
+#include "benchmark/benchmark.h"
+#include <new>
+#include <stack>
+#include <string>
+#include <vector>
+
+using namespace safe_stack;
+
+namespace {
+
+/// Returns `i`-th test value.
+template <class T>
+T make_value(int i) {
+    if constexpr (std::is_same_v<T, std::string>)
+        return std::string(32, static_cast<char>('a' + i % 26)); // no SSO
+    else
+        return static_cast<T>(i);
+}
+
+// Adapters for the baselines.
+
+template <class S, class T>
+void push(S &s, T &&value) {
+    s.push(std::forward<T>(value));
+}
+
+template <class T, class U>
+void push(std::vector<T> &s, U &&value) {
+    s.push_back(std::forward<U>(value));
+}
+
+template <class S>
+void pop(S &s) {
+    s.pop();
+}
+
+template <class T>
+void pop(std::vector<T> &s) {
+    s.pop_back();
+}
+
+template <class S>
+decltype(auto) top(S &s) {
+    return s.top();
+}
+
+template <class T>
+T &top(std::vector<T> &s) {
+    return s.back();
+}
+
+template <class T, std::size_t N, class C, class U>
+void push(StaticStack<T, N, C> &s, U &&value) {
+    (void)s.push(std::forward<U>(value));
+}
+
+template <class T, std::size_t N, class C>
+void pop(StaticStack<T, N, C> &s) {
+    (void)s.pop();
+}
+
+template <class T, std::size_t N, class C>
+T &top(StaticStack<T, N, C> &s) {
+    return *s.top();
+}
+
+template <class S>
+S filled(int count) {
+    S s;
+    for (int i = 0; i < count; ++i)
+        push(s, make_value<typename S::value_type>(i));
+    return s;
+}
+
+} // namespace
+
+/// Pushes `range(0)` elements to a new stack.
+template <class S>
+static void BM_Push(benchmark::State &state) {
+    using T = typename S::value_type;
+    auto count = static_cast<int>(state.range(0));
+    std::vector<T> values;
+    for (int i = 0; i < count; ++i)
+        values.push_back(make_value<T>(i));
+    for (auto _ : state) {
+        S s;
+        for (auto &value : values)
+            push(s, value);
+        benchmark::DoNotOptimize(&s);
+    }
+    state.SetItemsProcessed(state.iterations() * count);
+}
+
+/// Pushes `range(0)` elements to a new stack with one push_range() and
+/// removes them with one pop_n().
+template <class S>
+static void BM_PushRange(benchmark::State &state) {
+    using T = typename S::value_type;
+    auto count = static_cast<int>(state.range(0));
+    std::vector<T> values;
+    for (int i = 0; i < count; ++i)
+        values.push_back(make_value<T>(i));
+    for (auto _ : state) {
+        S s;
+        s.push_range(values.data(), values.data() + values.size());
+        benchmark::DoNotOptimize(&s);
+        s.pop_n(values.size());
+    }
+    state.SetItemsProcessed(state.iterations() * count);
+}
+
+/// Like BM_PushPop, but all operations are done in one batch.
+template <class S>
+static void BM_BatchPushPop(benchmark::State &state) {
+    using T = typename S::value_type;
+    auto count = static_cast<int>(state.range(0));
+    auto value = make_value<T>(42);
+    S s;
+    benchmark::DoNotOptimize(&s);
+    for (auto _ : state) {
+        auto batch = s.batch();
+        for (int i = 0; i < count; ++i)
+            batch.push(value);
+        benchmark::ClobberMemory();
+        for (int i = 0; i < count; ++i)
+            batch.pop();
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * count * 2);
+}
+
+/// Pushes `range(0)` elements and pops them back.
+template <class S>
+static void BM_PushPop(benchmark::State &state) {
+    using T = typename S::value_type;
+    auto count = static_cast<int>(state.range(0));
+    auto value = make_value<T>(42);
+    S s;
+    benchmark::DoNotOptimize(&s);
+    for (auto _ : state) {
+        for (int i = 0; i < count; ++i)
+            push(s, value);
+        benchmark::ClobberMemory(); // pushes can't be cancelled by pops
+        for (int i = 0; i < count; ++i)
+            pop(s);
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * count * 2);
+}
+
+/// Like BM_PushPop, while the scrubber checks the stack every millisecond.
+template <class S>
+static void BM_PushPopScrubbed(benchmark::State &state) {
+    scrub::start(std::chrono::milliseconds{1});
+    BM_PushPop<S>(state);
+    scrub::stop();
+}
+
+/// Reads top element of the stack with `range(0)` elements.
+template <class S>
+static void BM_Top(benchmark::State &state) {
+    auto s = filled<S>(static_cast<int>(state.range(0)));
+    for (auto _ : state)
+        benchmark::DoNotOptimize(&top(s));
+    state.SetItemsProcessed(state.iterations());
+}
+
+/// Reserves memory for `range(0)` elements in a new stack.
+template <class S>
+static void BM_Reserve(benchmark::State &state) {
+    for (auto _ : state) {
+        S s;
+        s.reserve(state.range(0));
+        benchmark::DoNotOptimize(&s);
+    }
+}
+
+/// Copies the stack with `range(0)` elements.
+template <class S>
+static void BM_Copy(benchmark::State &state) {
+    auto s = filled<S>(static_cast<int>(state.range(0)));
+    for (auto _ : state) {
+        S copy{s};
+        benchmark::DoNotOptimize(&copy);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+/// Moves the stack with `range(0)` elements back and forth.
+/// Moved-out safe stack is invalid and can't be assigned to, so it is
+/// recreated in place.
+template <class S>
+static void BM_Move(benchmark::State &state) {
+    auto s = filled<S>(static_cast<int>(state.range(0)));
+    for (auto _ : state) {
+        S moved{std::move(s)};
+        s.~S();
+        new (&s) S{std::move(moved)};
+        benchmark::DoNotOptimize(&s);
+    }
+}
+
+template <class T, class Policy, class Allocator = std::allocator<T>>
+using SafeStack = Stack<T, Allocator, Policy>;
+
+#define STACK_BENCHMARKS(...)                                                  \
+    BENCHMARK_TEMPLATE(BM_Push, __VA_ARGS__)->Arg(1 << 10)->Arg(1 << 16);      \
+    BENCHMARK_TEMPLATE(BM_PushPop, __VA_ARGS__)->Arg(1 << 10);                 \
+    BENCHMARK_TEMPLATE(BM_Top, __VA_ARGS__)->Arg(1 << 10);                     \
+    BENCHMARK_TEMPLATE(BM_Copy, __VA_ARGS__)->Arg(1 << 10)->Arg(1 << 16);      \
+    BENCHMARK_TEMPLATE(BM_Move, __VA_ARGS__)->Arg(1 << 10)
+
+#define RESERVABLE_BENCHMARKS(...)                                             \
+    STACK_BENCHMARKS(__VA_ARGS__);                                             \
+    BENCHMARK_TEMPLATE(BM_Reserve, __VA_ARGS__)->Arg(1 << 10)->Arg(1 << 16)
+
+#define ALL_BENCHMARKS(T)                                                      \
+    STACK_BENCHMARKS(std::stack<T>);                                           \
+    RESERVABLE_BENCHMARKS(std::vector<T>);                                     \
+    RESERVABLE_BENCHMARKS(SafeStack<T, checks::None>);                         \
+    RESERVABLE_BENCHMARKS(SafeStack<T, checks::CanariesOnly>);                 \
+    RESERVABLE_BENCHMARKS(SafeStack<T, checks::HashOnly>);                     \
+    RESERVABLE_BENCHMARKS(SafeStack<T, checks::Fast>);                         \
+    RESERVABLE_BENCHMARKS(SafeStack<T, checks::Full>);                         \
+    RESERVABLE_BENCHMARKS(SafeStack<T, checks::WithPayload<checks::Full>>);    \
+    RESERVABLE_BENCHMARKS(SafeStack<T, checks::WithBlocks<checks::Full>>);     \
+    RESERVABLE_BENCHMARKS(                                                     \
+        SafeStack<T, checks::WithBufferCanaries<checks::Full>>);               \
+    RESERVABLE_BENCHMARKS(                                                     \
+        SafeStack<T, checks::CanariesOnly, GuardedAllocator<T>>);              \
+    RESERVABLE_BENCHMARKS(SafeStack<T, checks::Full, GuardedAllocator<T>>);   \
+    RESERVABLE_BENCHMARKS(SafeStack<T, checks::Full, MallocAllocator<T>>);    \
+    STACK_BENCHMARKS(SegmentedStack<T>)
+
+/// Pushes `range(0)` elements, then takes them with `top()` and `pop()`.
+template <class S>
+static void BM_DrainTopPop(benchmark::State &state) {
+    using T = typename S::value_type;
+    auto count = static_cast<int>(state.range(0));
+    auto value = make_value<T>(42);
+    S s;
+    for (auto _ : state) {
+        for (int i = 0; i < count; ++i)
+            s.push(value);
+        while (!s.empty()) {
+            T elem = s.top();
+            s.pop();
+            benchmark::DoNotOptimize(elem);
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * count);
+}
+
+/// Pushes `range(0)` elements, then takes them with `pop_value()`.
+template <class S>
+static void BM_DrainPopValue(benchmark::State &state) {
+    using T = typename S::value_type;
+    auto count = static_cast<int>(state.range(0));
+    auto value = make_value<T>(42);
+    S s;
+    for (auto _ : state) {
+        for (int i = 0; i < count; ++i)
+            s.push(value);
+        while (!s.empty()) {
+            T elem = s.pop_value();
+            benchmark::DoNotOptimize(elem);
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * count);
+}
+
+/// Pushes `range(0)` elements and pops them until `pop()` throws.
+template <class S>
+static void BM_DrainThrowing(benchmark::State &state) {
+    auto count = static_cast<int>(state.range(0));
+    S s;
+    for (auto _ : state) {
+        for (int i = 0; i < count; ++i)
+            s.push(i);
+        for (;;) {
+            try {
+                benchmark::DoNotOptimize(s.top());
+                s.pop();
+            } catch (const StackUnderflow &) {
+                break;
+            }
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * count);
+}
+
+/// Pushes `range(0)` elements and pops them until `try_pop()` fails.
+template <class S>
+static void BM_DrainTry(benchmark::State &state) {
+    auto count = static_cast<int>(state.range(0));
+    S s;
+    for (auto _ : state) {
+        for (int i = 0; i < count; ++i)
+            (void)s.try_push(i);
+        while (auto value = s.try_pop())
+            benchmark::DoNotOptimize(*value);
+    }
+    state.SetItemsProcessed(state.iterations() * count);
+}
+
+ALL_BENCHMARKS(int);
+ALL_BENCHMARKS(std::string);
+
+// every operation is O(n), so only small stacks
+BENCHMARK_TEMPLATE(BM_PushPop, SafeStack<int, checks::Paranoid>)->Arg(1 << 10);
+BENCHMARK_TEMPLATE(BM_Top, SafeStack<int, checks::Paranoid>)->Arg(1 << 10);
+
+// growing to millions of elements: memcpy, realloc, mremap and resizing in
+// place
+BENCHMARK_TEMPLATE(BM_Push, std::vector<int>)->Arg(1 << 22);
+BENCHMARK_TEMPLATE(BM_Push, SafeStack<int, checks::Full>)->Arg(1 << 22);
+BENCHMARK_TEMPLATE(BM_Push, SafeStack<int, checks::Full, MallocAllocator<int>>)
+    ->Arg(1 << 22);
+BENCHMARK_TEMPLATE(BM_Push, SafeStack<int, checks::Full, MmapAllocator<int>>)
+    ->Arg(1 << 22);
+BENCHMARK_TEMPLATE(BM_Push,
+                   SafeStack<int, checks::Full, VirtualAllocator<int>>)
+    ->Arg(1 << 22);
+BENCHMARK_TEMPLATE(BM_Push, SafeStack<std::string, checks::Full>)
+    ->Arg(1 << 20);
+BENCHMARK_TEMPLATE(BM_Push, SafeStack<std::string, checks::Full,
+                                      VirtualAllocator<std::string>>)
+    ->Arg(1 << 20);
+BENCHMARK_TEMPLATE(BM_Reserve, SafeStack<int, checks::None>)->Arg(1 << 24);
+BENCHMARK_TEMPLATE(BM_Reserve, SafeStack<int, checks::None, MmapAllocator<int>>)
+    ->Arg(1 << 24);
+
+// short-lived small stacks: heap buffer and inline buffer
+BENCHMARK_TEMPLATE(BM_Push, std::vector<int>)->Arg(16);
+BENCHMARK_TEMPLATE(BM_Push, SafeStack<int, checks::Full>)->Arg(16);
+BENCHMARK_TEMPLATE(BM_Push, SmallStack<int, 32>)->Arg(16);
+BENCHMARK_TEMPLATE(BM_Push, SmallStack<int, 32, std::allocator<int>,
+                                       checks::None>)
+    ->Arg(16);
+
+// allocation-free stack
+BENCHMARK_TEMPLATE(BM_PushPop, StaticStack<int, 1 << 10>)->Arg(1 << 10);
+BENCHMARK_TEMPLATE(BM_Top, StaticStack<int, 1 << 10>)->Arg(1 << 10);
+BENCHMARK_TEMPLATE(BM_PushPop, StaticStack<int, 1 << 10, checks::None>)
+    ->Arg(1 << 10);
+
+// loop-until-empty: exception unwinding vs status
+BENCHMARK_TEMPLATE(BM_DrainThrowing, SafeStack<int, checks::Full>)
+    ->Arg(1)
+    ->Arg(16)
+    ->Arg(1 << 10);
+BENCHMARK_TEMPLATE(BM_DrainTry, SafeStack<int, checks::Full>)
+    ->Arg(1)
+    ->Arg(16)
+    ->Arg(1 << 10);
+
+// top() + pop() copies the element and validates twice
+BENCHMARK_TEMPLATE(BM_DrainTopPop, SafeStack<int, checks::Full>)->Arg(1 << 10);
+BENCHMARK_TEMPLATE(BM_DrainPopValue, SafeStack<int, checks::Full>)
+    ->Arg(1 << 10);
+BENCHMARK_TEMPLATE(BM_DrainTopPop, SafeStack<std::string, checks::Full>)
+    ->Arg(1 << 10);
+BENCHMARK_TEMPLATE(BM_DrainPopValue, SafeStack<std::string, checks::Full>)
+    ->Arg(1 << 10);
+
+// bulk operations: one validation, memcpy for trivial elements
+BENCHMARK_TEMPLATE(BM_Push, SafeStack<int, checks::Full>)->Arg(1 << 16);
+BENCHMARK_TEMPLATE(BM_PushRange, SafeStack<int, checks::Full>)->Arg(1 << 16);
+BENCHMARK_TEMPLATE(BM_PushRange,
+                   SafeStack<int, checks::WithPayload<checks::Full>>)
+    ->Arg(1 << 16);
+BENCHMARK_TEMPLATE(BM_Push, SafeStack<std::string, checks::Full>)
+    ->Arg(1 << 16);
+BENCHMARK_TEMPLATE(BM_PushRange, SafeStack<std::string, checks::Full>)
+    ->Arg(1 << 16);
+
+// one validation per batch instead of one per operation
+BENCHMARK_TEMPLATE(BM_PushPop, SafeStack<int, checks::Full>)->Arg(16);
+BENCHMARK_TEMPLATE(BM_BatchPushPop, SafeStack<int, checks::Full>)
+    ->Arg(16)
+    ->Arg(1 << 10);
+BENCHMARK_TEMPLATE(BM_BatchPushPop, SafeStack<std::string, checks::Full>)
+    ->Arg(1 << 10);
+
+// lazy hash: checked every 64 mutations or only when the buffer changes
+BENCHMARK_TEMPLATE(BM_Push,
+                   SafeStack<int, checks::WithLazyHash<checks::Full, 64>>)
+    ->Arg(1 << 16);
+BENCHMARK_TEMPLATE(BM_Push, SafeStack<int, checks::WithLazyHash<checks::Full>>)
+    ->Arg(1 << 16);
+BENCHMARK_TEMPLATE(BM_PushPop,
+                   SafeStack<int, checks::WithLazyHash<checks::Full, 64>>)
+    ->Arg(1 << 10);
+
+// sampled checks of reads
+BENCHMARK_TEMPLATE(BM_Top, SafeStack<int, checks::Sampled<checks::Full, 16>>)
+    ->Arg(1 << 10);
+BENCHMARK_TEMPLATE(BM_Top,
+                   SafeStack<int, checks::Sampled<checks::Full, 16, true>>)
+    ->Arg(1 << 10);
+// mutations aren't sampled: push/pop costs as much as with checks::Full
+BENCHMARK_TEMPLATE(BM_PushPop,
+                   SafeStack<int, checks::Sampled<checks::Full, 16>>)
+    ->Arg(1 << 10);
+
+// write sections of the scrubber's seqlock, with and without the scrubber
+BENCHMARK_TEMPLATE(BM_PushPop,
+                   SafeStack<int, checks::WithScrubber<checks::Full>>)
+    ->Arg(1 << 10);
+BENCHMARK_TEMPLATE(BM_PushPopScrubbed,
+                   SafeStack<int, checks::WithScrubber<checks::Full>>)
+    ->Arg(1 << 10);
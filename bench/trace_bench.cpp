@@ -0,0 +1,25 @@
+#include "safe_stack/safe_stack.h"
+#include "safe_stack/trace.h"
+#include "benchmark/benchmark.h"
+
+using namespace safe_stack;
+
+/// Pushes `range(0)` elements and pops them back with the given logger.
+template <class Logger>
+static void BM_LoggedPushPop(benchmark::State &state) {
+    Stack<int, std::allocator<int>, checks::None, Logger> s;
+    auto count = static_cast<int>(state.range(0));
+    trace::start("/dev/null");
+    for (auto _ : state) {
+        for (int i = 0; i < count; ++i)
+            s.push(i);
+        for (int i = 0; i < count; ++i)
+            s.pop();
+    }
+    trace::stop();
+    state.SetItemsProcessed(state.iterations() * count * 2);
+    state.counters["dropped"] = trace::Tracer::instance().dropped();
+}
+
+BENCHMARK_TEMPLATE(BM_LoggedPushPop, logging::None)->Arg(1024);
+BENCHMARK_TEMPLATE(BM_LoggedPushPop, trace::Logger)->Arg(1024);
@@ -0,0 +1,179 @@
+#ifndef SAFE_STACK_CHECKS_H
+#define SAFE_STACK_CHECKS_H
+
+#include <cstddef>
+
+/// \brief Check policies of the safe stack.
+/// Check policy is a type with a set of `static constexpr bool` flags.
+/// Stack reads them at compile time, so disabled checks cost nothing.
+/// Custom policies should derive from ::None and override some flags.
+namespace safe_stack::checks {
+
+/// \brief No integrity checks at all.
+/// Stack behaves like a plain vector-based stack. Operations on invalid
+/// (for example moved-out) stack are undefined behaviour.
+struct None {
+    /// \brief Check start and end canaries.
+    static constexpr bool canaries = false;
+
+    /// \brief Maintain checksum of the stack's fields and check it.
+    static constexpr bool hash = false;
+
+    /// \brief Check \f$size \le capacity\f$ and similar invariants.
+    static constexpr bool invariants = false;
+
+    /// \brief Validate the stack after every mutation too, not only before.
+    static constexpr bool on_exit = false;
+
+    /// \brief Maintain checksum of the elements (O(1) per push/pop).
+    /// It is checked by `deep_validate()`.
+    static constexpr bool payload = false;
+
+    /// \brief Check checksum of the elements in every validation (O(n)).
+    static constexpr bool deep = false;
+
+    /// \brief Number of elements in one block of element checksums
+    /// (0 - elements are not split into blocks).
+    static constexpr std::size_t block_size = 0;
+
+    /// \brief Check the block with the last sealed element in `top()`
+    /// (::SegmentedStack checks the chunk with it).
+    static constexpr bool check_last_block = false;
+
+    /// \brief Put canaries right before the first and after the last
+    /// element in the allocated buffer and check them (two loads).
+    static constexpr bool buffer_canaries = false;
+
+    /// \brief Update the hash in O(1) on push and pop instead of rehashing
+    /// the stack, and check it only at checkpoints: every `check_interval`
+    /// mutations, on reads (if `check_on_read` is set), when the buffer
+    /// changes and by `checkpoint()`. Corruption between checkpoints is
+    /// detected at the next one.
+    static constexpr bool lazy_hash = false;
+
+    /// \brief Number of mutations after which lazy hash is checked (0 - only
+    /// at other checkpoints).
+    static constexpr std::size_t check_interval = 0;
+
+    /// \brief Check lazy hash in `size()`, `empty()` and `top()`.
+    static constexpr bool check_on_read = false;
+
+    /// \brief Check hash and elements on reads (`size()`, `top()`...) only
+    /// once per `sample_period` reads. Only reads are amortized: mutations
+    /// are always fully checked (they rehash the stack, so a skipped check
+    /// would sign the corruption). Use `WithLazyHash` to amortize mutations.
+    static constexpr bool sampled = false;
+
+    /// \brief Initial sample period (it can be changed at runtime).
+    static constexpr std::size_t sample_period = 1;
+
+    /// \brief Sample reads randomly (with probability `1 / sample_period`)
+    /// instead of every `sample_period`-th read.
+    static constexpr bool random_sampling = false;
+
+    /// \brief Register the stack in the background scrubber (see
+    /// safe_stack::scrub). Every change of the stack becomes a seqlock write
+    /// section.
+    static constexpr bool scrubbed = false;
+};
+
+/// \brief Only canaries and invariants are checked, checksum is not computed.
+struct CanariesOnly : None {
+    static constexpr bool canaries = true;
+    static constexpr bool invariants = true;
+};
+
+/// \brief Only checksum and invariants are checked.
+struct HashOnly : None {
+    static constexpr bool hash = true;
+    static constexpr bool invariants = true;
+};
+
+/// \brief Every check is done before every operation, but not after
+/// mutations (half of the checks of ::Full, for hot paths).
+struct Fast : None {
+    static constexpr bool canaries = true;
+    static constexpr bool hash = true;
+    static constexpr bool invariants = true;
+};
+
+/// \brief Every check is done before and after every operation (default).
+struct Full : Fast {
+    static constexpr bool on_exit = true;
+};
+
+/// \brief Like ::Full, but elements and canaries around them are checked
+/// every time too: every operation, including reads, is O(n). With
+/// `WithBlocks` the elements are checked by the calling thread (only
+/// `deep_validate()` checks blocks in parallel).
+struct Paranoid : Full {
+    static constexpr bool payload = true;
+    static constexpr bool deep = true;
+    static constexpr bool buffer_canaries = true;
+};
+
+/// \brief Adds checksum of the elements to the `Base` policy.
+template <class Base>
+struct WithPayload : Base {
+    static constexpr bool payload = true;
+};
+
+/// \brief Adds canaries around the elements to the `Base` policy.
+template <class Base>
+struct WithBufferCanaries : Base {
+    static constexpr bool buffer_canaries = true;
+};
+
+/// \brief Adds checksums of blocks of `BlockSize` elements to the `Base`
+/// policy. `top()` checks only the last block (O(BlockSize)),
+/// `deep_validate()` checks blocks in parallel.
+template <class Base, std::size_t BlockSize = 64>
+struct WithBlocks : WithPayload<Base> {
+    static_assert(BlockSize != 0, "block must not be empty");
+    static constexpr std::size_t block_size = BlockSize;
+    static constexpr bool check_last_block = true;
+};
+
+/// \brief Makes hash of the `Base` policy lazy: push and pop update it in
+/// O(1), and it is checked every `CheckInterval` mutations (never if 0), on
+/// reads if `CheckOnRead` is set, when the buffer changes and by
+/// `checkpoint()`. Canaries and invariants are checked always.
+template <class Base, std::size_t CheckInterval = 0, bool CheckOnRead = false>
+struct WithLazyHash : Base {
+    static constexpr bool lazy_hash = true;
+    static constexpr std::size_t check_interval = CheckInterval;
+    static constexpr bool check_on_read = CheckOnRead;
+};
+
+/// \brief Samples checks of the hash and elements on reads of the `Base`
+/// policy: only one of `Period` reads is fully checked (randomly if `Random`
+/// is set). Canaries and invariants are checked always. Mutations aren't
+/// sampled and cost as much as with `Base`; combine with `WithLazyHash` to
+/// check them every `CheckInterval` mutations instead.
+template <class Base, std::size_t Period = 16, bool Random = false>
+struct Sampled : Base {
+    static_assert(Period != 0, "sample period must be positive");
+    static constexpr bool sampled = true;
+    static constexpr std::size_t sample_period = Period;
+    static constexpr bool random_sampling = Random;
+};
+
+/// \brief Registers stacks with the `Base` policy in the background scrubber
+/// (see safe_stack::scrub).
+template <class Base>
+struct WithScrubber : Base {
+    static constexpr bool scrubbed = true;
+};
+
+} // namespace safe_stack::checks
+
+namespace safe_stack::detail {
+
+/// \brief Type of the member which is disabled by the policy.
+/// Used with `[[no_unique_address]]`, so it takes no space.
+template <int tag>
+struct Nothing {};
+
+} // namespace safe_stack::detail
+
+#endif // SAFE_STACK_CHECKS_H
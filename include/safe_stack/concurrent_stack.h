@@ -0,0 +1,168 @@
+#ifndef SAFE_STACK_CONCURRENT_STACK_H
+#define SAFE_STACK_CONCURRENT_STACK_H
+
+#include "safe_stack/checks.h"
+#include "safe_stack/safe_stack.h"
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <utility> // for std::move
+
+#if defined(__x86_64__) || defined(__i386__)
+#define SAFE_STACK_SPIN_PAUSE 1
+#include <immintrin.h>
+#endif
+
+namespace safe_stack {
+
+/// \brief Test-and-test-and-set spinlock with exponential backoff.
+/// Satisfies `Lockable`, so it works with `std::lock_guard`.
+class SpinLock {
+public:
+    /// \brief Number of pause instructions after which the waiting thread
+    /// yields instead of spinning.
+    static constexpr unsigned max_backoff = 1024;
+
+    void lock() noexcept {
+        unsigned backoff = 1;
+        while (!try_lock()) {
+            // wait on a plain load, so the cache line isn't bounced by writes
+            while (_locked.load(std::memory_order_relaxed)) {
+                if (backoff > max_backoff) {
+                    std::this_thread::yield();
+                    continue;
+                }
+                for (unsigned i = 0; i < backoff; ++i)
+                    pause();
+                backoff *= 2;
+            }
+        }
+    }
+
+    bool try_lock() noexcept {
+        return !_locked.load(std::memory_order_relaxed) &&
+               !_locked.exchange(true, std::memory_order_acquire);
+    }
+
+    void unlock() noexcept { _locked.store(false, std::memory_order_release); }
+
+private:
+    std::atomic<bool> _locked{false};
+
+    static void pause() noexcept {
+#ifdef SAFE_STACK_SPIN_PAUSE
+        _mm_pause();
+#else
+        std::atomic_signal_fence(std::memory_order_seq_cst);
+#endif
+    }
+};
+
+/// \brief Thread-safe safe stack.
+///
+/// Every operation on the underlying ::Stack is done with `Lock` held, so
+/// push, pop and try_pop are linearizable. The stack keeps its integrity
+/// checks: corruption is reported by the thread which found it.
+///
+/// size() and empty() don't take the lock and don't touch the stack: they
+/// read a copy of the size published after every change (a value the stack
+/// had at some moment during the call).
+template <class T, class Allocator = std::allocator<T>,
+          class CheckPolicy = checks::Full, class Lock = SpinLock>
+class ConcurrentStack {
+public:
+    /// \brief Type of the elements.
+    using value_type = T;
+
+    /// \brief Type of the underlying stack.
+    using stack_type = Stack<T, Allocator, CheckPolicy>;
+
+    ConcurrentStack() = default;
+
+    ConcurrentStack(const ConcurrentStack &) = delete;
+    ConcurrentStack &operator=(const ConcurrentStack &) = delete;
+
+    /// \brief Pushes element to the end of the stack.
+    /// \exception ::StackInvalidState The stack was invalid.
+    void push(const T &elem) { emplace(elem); }
+
+    /// \brief Pushes element to the end of the stack.
+    void push(T &&elem) { emplace(std::move(elem)); }
+
+    /// \brief Constructs element at the end of the stack.
+    template <class... Args>
+    void emplace(Args &&... args) {
+        std::lock_guard<Lock> lock{_lock};
+        _stack.emplace(std::forward<Args>(args)...);
+        publish_size(size() + 1);
+    }
+
+    /// \brief Removes the top element and returns it.
+    /// \exception ::StackUnderflow Stack was empty.
+    /// \exception ::StackInvalidState Stack was invalid.
+    T pop() {
+        std::lock_guard<Lock> lock{_lock};
+        T result = _stack.pop_value();
+        publish_size(size() - 1);
+        return result;
+    }
+
+    /// \brief Removes the top element and returns it without exceptions.
+    /// \return std::nullopt if the stack was empty or invalid.
+    std::optional<T> try_pop() noexcept(
+        std::is_nothrow_move_constructible_v<T>) {
+        std::lock_guard<Lock> lock{_lock};
+        auto result = _stack.try_pop();
+        if (result)
+            publish_size(size() - 1);
+        return result;
+    }
+
+    /// \brief Returns a copy of the top element.
+    /// \return std::nullopt if the stack was empty or invalid.
+    std::optional<T> top() const {
+        std::lock_guard<Lock> lock{_lock};
+        if (auto top = _stack.try_top())
+            return *top;
+        return std::nullopt;
+    }
+
+    /// \brief Removes all elements.
+    /// \exception ::StackInvalidState Stack was invalid.
+    void clear() {
+        std::lock_guard<Lock> lock{_lock};
+        _stack.clear();
+        publish_size(0);
+    }
+
+    /// \brief Returns a number of elements (without the lock and checks).
+    std::size_t size() const noexcept {
+        return _size.load(std::memory_order_acquire);
+    }
+
+    /// \brief Checks if the stack is empty (without the lock and checks).
+    bool empty() const noexcept { return size() == 0; }
+
+    /// \brief Checks if the underlying stack is valid.
+    bool valid() const {
+        std::lock_guard<Lock> lock{_lock};
+        return _stack.valid();
+    }
+
+private:
+    mutable Lock _lock;
+    stack_type _stack;
+    std::atomic<std::size_t> _size{0};
+
+    /// \brief Publishes the size of the stack (lock must be held).
+    void publish_size(std::size_t size) noexcept {
+        _size.store(size, std::memory_order_release);
+    }
+};
+
+} // namespace safe_stack
+
+#endif // SAFE_STACK_CONCURRENT_STACK_H
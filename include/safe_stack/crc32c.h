@@ -0,0 +1,109 @@
+#ifndef SAFE_STACK_CRC32C_H
+#define SAFE_STACK_CRC32C_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring> // for std::memcpy
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define SAFE_STACK_CRC32C_SSE42 1
+#include <nmmintrin.h>
+#endif
+
+namespace safe_stack {
+
+namespace detail {
+
+/// \brief Reversed Castagnoli polynomial.
+constexpr std::uint32_t crc32c_polynomial = 0x82F63B78;
+
+constexpr std::array<std::uint32_t, 256> make_crc32c_table() {
+    std::array<std::uint32_t, 256> table{};
+    for (std::uint32_t i = 0; i < 256; ++i) {
+        std::uint32_t crc = i;
+        for (int bit = 0; bit < 8; ++bit)
+            crc = (crc >> 1) ^ ((crc & 1) ? crc32c_polynomial : 0);
+        table[i] = crc;
+    }
+    return table;
+}
+
+constexpr auto crc32c_table = make_crc32c_table();
+
+} // namespace detail
+
+/// \brief Table-driven CRC32C, works everywhere.
+/// \param crc CRC of the preceding data (to compute CRC of several parts).
+inline std::uint32_t crc32c_software(const void *data, std::size_t size,
+                                     std::uint32_t crc = 0) {
+    auto bytes = static_cast<const unsigned char *>(data);
+    crc = ~crc;
+    for (std::size_t i = 0; i < size; ++i)
+        crc = (crc >> 8) ^ detail::crc32c_table[(crc ^ bytes[i]) & 0xFF];
+    return ~crc;
+}
+
+#ifdef SAFE_STACK_CRC32C_SSE42
+/// \brief CRC32C using SSE4.2 `crc32` instruction, 8 bytes per instruction.
+/// Must be called only if crc32c_hardware_available() returns true.
+__attribute__((target("sse4.2"))) inline std::uint32_t
+crc32c_hardware(const void *data, std::size_t size, std::uint32_t crc = 0) {
+    auto bytes = static_cast<const unsigned char *>(data);
+    std::uint64_t state = ~crc;
+    std::size_t i = 0;
+    for (; i + sizeof(std::uint64_t) <= size; i += sizeof(std::uint64_t)) {
+        std::uint64_t word;
+        std::memcpy(&word, bytes + i, sizeof(word));
+        state = _mm_crc32_u64(state, word);
+    }
+    auto result = static_cast<std::uint32_t>(state);
+    for (; i < size; ++i)
+        result = _mm_crc32_u8(result, bytes[i]);
+    return ~result;
+}
+#endif
+
+/// \brief Checks if the CPU supports hardware CRC32C.
+inline bool crc32c_hardware_available() {
+#ifdef SAFE_STACK_CRC32C_SSE42
+    static const bool available = __builtin_cpu_supports("sse4.2");
+    return available;
+#else
+    return false;
+#endif
+}
+
+/// \brief Computes CRC32C with the fastest implementation available.
+/// Implementation is selected once (using CPUID).
+inline std::uint32_t crc32c(const void *data, std::size_t size,
+                            std::uint32_t crc = 0) {
+    using Implementation =
+        std::uint32_t (*)(const void *, std::size_t, std::uint32_t);
+    static const Implementation implementation = [] {
+#ifdef SAFE_STACK_CRC32C_SSE42
+        if (crc32c_hardware_available())
+            return static_cast<Implementation>(crc32c_hardware);
+#endif
+        return static_cast<Implementation>(crc32c_software);
+    }();
+    return implementation(data, size, crc);
+}
+
+namespace hashers {
+
+/// \brief CRC32C checksum (hardware accelerated where possible).
+/// Detects all burst errors up to 32 bits long.
+struct Crc32c {
+    using result_type = std::uint32_t;
+
+    static result_type hash(const void *data, std::size_t size) {
+        return crc32c(data, size);
+    }
+};
+
+} // namespace hashers
+
+} // namespace safe_stack
+
+#endif // SAFE_STACK_CRC32C_H
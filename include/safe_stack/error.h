@@ -0,0 +1,43 @@
+#ifndef SAFE_STACK_ERROR_H
+#define SAFE_STACK_ERROR_H
+
+namespace safe_stack {
+
+/// \brief Thrown when something went wrong.
+struct StackError {};
+
+/// \brief Thrown when stack doesn't have enough elements.
+struct StackUnderflow : public StackError {};
+
+/// \brief Thrown when stack was in some incorrect state.
+struct StackInvalidState : public StackError {};
+
+/// \brief Result of the operation which doesn't throw exceptions.
+enum class [[nodiscard]] Status : unsigned char {
+    ok,
+    /// Stack doesn't have enough elements (see ::StackUnderflow).
+    underflow,
+    /// Stack doesn't have space for more elements.
+    overflow,
+    /// Stack was in some incorrect state (see ::StackInvalidState).
+    invalid_state,
+};
+
+/// \brief Returns a name of the status.
+constexpr const char *to_string(Status status) noexcept {
+    switch (status) {
+    case Status::ok:
+        return "ok";
+    case Status::underflow:
+        return "underflow";
+    case Status::overflow:
+        return "overflow";
+    case Status::invalid_state:
+        return "invalid state";
+    }
+    return "unknown";
+}
+
+} // namespace safe_stack
+
+#endif // SAFE_STACK_ERROR_H
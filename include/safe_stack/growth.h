@@ -0,0 +1,70 @@
+#ifndef SAFE_STACK_GROWTH_H
+#define SAFE_STACK_GROWTH_H
+
+#include <algorithm>
+#include <cstddef>
+
+/// \brief Growth policies of the safe stack.
+/// Growth policy is a type with two functions:
+/// - `static std::size_t grow(std::size_t capacity)` returns new capacity of
+/// the full stack (it must be greater than `capacity`);
+/// - `static std::size_t shrink(std::size_t size, std::size_t capacity)`
+/// returns new capacity after pop (`capacity` if stack shouldn't shrink).
+namespace safe_stack::growth {
+
+/// \brief Original policy: capacity is doubled, stack is shrunk to its size
+/// when less than 40% of it is used. Push right after shrink reallocates.
+struct Legacy {
+    static std::size_t grow(std::size_t capacity) { return capacity * 2 + 1; }
+
+    static std::size_t shrink(std::size_t size, std::size_t capacity) {
+        return size < capacity * 0.4 ? size : capacity;
+    }
+};
+
+/// \brief Capacity is doubled, halved when less than a quarter of it is used
+/// (default). Small stacks (up to `min_capacity`) are never shrunk.
+struct Hysteresis {
+    static constexpr std::size_t min_capacity = 16;
+
+    static std::size_t grow(std::size_t capacity) { return capacity * 2 + 1; }
+
+    static std::size_t shrink(std::size_t size, std::size_t capacity) {
+        if (capacity <= min_capacity || size * 4 >= capacity)
+            return capacity;
+        return std::max(size * 2, min_capacity);
+    }
+};
+
+/// \brief Capacity is doubled and never decreases (until clear()).
+struct NeverShrink {
+    static std::size_t grow(std::size_t capacity) { return capacity * 2 + 1; }
+
+    static std::size_t shrink(std::size_t, std::size_t capacity) {
+        return capacity;
+    }
+};
+
+/// \brief Capacity grows by 1.5 (less than the golden ratio
+/// \f$\varphi \approx 1.618\f$), so the sum of freed buffers eventually
+/// exceeds the next request and the allocator can reuse them. Stack is shrunk
+/// by the same factor when less than \f$1/1.5^4 = 16/81\f$ of it is used:
+/// capacity is at most 1.5 times the peak size, so a stack whose size swings
+/// within \f$1.5^3\f$ of its peak doesn't reallocate.
+struct ThreeHalves {
+    static constexpr std::size_t min_capacity = 16;
+
+    static std::size_t grow(std::size_t capacity) {
+        return capacity + capacity / 2 + 1;
+    }
+
+    static std::size_t shrink(std::size_t size, std::size_t capacity) {
+        if (capacity <= min_capacity || size * 81 >= capacity * 16)
+            return capacity;
+        return std::max(size + size / 2, min_capacity);
+    }
+};
+
+} // namespace safe_stack::growth
+
+#endif // SAFE_STACK_GROWTH_H
@@ -0,0 +1,93 @@
+#ifndef SAFE_STACK_GUARDED_ALLOCATOR_H
+#define SAFE_STACK_GUARDED_ALLOCATOR_H
+
+#include "safe_stack/pages.h"
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <new> // for std::bad_alloc, std::bad_array_new_length
+#include <sys/mman.h>
+
+namespace safe_stack {
+
+/// \brief Allocator which surrounds every buffer with inaccessible pages.
+///
+/// Buffer is mapped with `mmap` between two `PROT_NONE` guard pages and is
+/// placed at the end of its pages, so any write past the end of the buffer
+/// traps immediately (SIGSEGV). Writes before the beginning trap after they
+/// cross the unused part of the first page. Checks are done by hardware and
+/// cost nothing per operation, but every allocation takes at least three
+/// pages and a system call.
+///
+/// With checks::WithBufferCanaries the stack puts its end canary after the
+/// elements, so the canary touches the guard page: an overrun of the
+/// elements overwrites the canary first (it is detected by the next check)
+/// and traps only when it passes the canary.
+///
+/// Works on POSIX systems only.
+template <class T>
+class GuardedAllocator {
+public:
+    using value_type = T;
+
+    GuardedAllocator() noexcept = default;
+
+    template <class U>
+    GuardedAllocator(const GuardedAllocator<U> &) noexcept {}
+
+    /// \brief Returns the maximal number of objects in one buffer (the buffer
+    /// and its guard pages must fit in the address space).
+    std::size_t max_size() const noexcept {
+        return (std::numeric_limits<std::size_t>::max() -
+                3 * detail::page_size()) /
+               sizeof(T);
+    }
+
+    /// \brief Allocates memory for `n` objects.
+    /// \exception std::bad_array_new_length `n` is greater than max_size().
+    /// \exception std::bad_alloc Memory cannot be mapped.
+    T *allocate(std::size_t n) {
+        if (n > max_size())
+            throw std::bad_array_new_length{};
+        auto page = detail::page_size();
+        auto bytes = detail::round_to_pages(n * sizeof(T));
+        if (bytes == 0)
+            bytes = page;
+        auto total = bytes + 2 * page;
+        void *memory = mmap(nullptr, total, PROT_NONE,
+                            MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (memory == MAP_FAILED)
+            throw std::bad_alloc{};
+        auto data = static_cast<char *>(memory) + page;
+        if (mprotect(data, bytes, PROT_READ | PROT_WRITE) != 0) {
+            munmap(memory, total);
+            throw std::bad_alloc{};
+        }
+        // end of the buffer touches the second guard page
+        return reinterpret_cast<T *>(data + bytes - n * sizeof(T));
+    }
+
+    /// \brief Unmaps memory allocated by allocate().
+    void deallocate(T *p, std::size_t n) noexcept {
+        auto page = detail::page_size();
+        auto bytes = detail::round_to_pages(n * sizeof(T));
+        if (bytes == 0)
+            bytes = page;
+        auto data = reinterpret_cast<char *>(p + n) - bytes;
+        munmap(data - page, bytes + 2 * page);
+    }
+
+    template <class U>
+    bool operator==(const GuardedAllocator<U> &) const noexcept {
+        return true;
+    }
+
+    template <class U>
+    bool operator!=(const GuardedAllocator<U> &) const noexcept {
+        return false;
+    }
+};
+
+} // namespace safe_stack
+
+#endif // SAFE_STACK_GUARDED_ALLOCATOR_H
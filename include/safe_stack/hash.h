@@ -1,21 +1,109 @@
+#ifndef SAFE_STACK_HASH_H
+#define SAFE_STACK_HASH_H
+
 #include <cstddef>
+#include <cstdint>
+#include <cstring> // for std::memcpy
+
 namespace safe_stack {
 
-/// \brief Data type of the hash (currently only one byte)
+/// \brief Data type of the byte hash (only one byte)
 using HashType = unsigned char;
 
 /// \brief Multiplier for every next operation of the hash algorithm
 constexpr HashType hash_factor = 31;
 
+/// \brief Hash functions of the safe stack.
+/// Hasher is a type with `result_type` and
+/// `static result_type hash(const void *data, std::size_t size)`.
+namespace hashers {
+
+/// \brief Original byte-at-a-time hash, one multiplication per byte.
+struct Byte {
+    using result_type = HashType;
+
+    static result_type hash(const void *data, std::size_t size) {
+        result_type result = 1;
+        for (std::size_t i = 0; i < size; ++i)
+            result = hash_factor * result +
+                     static_cast<const unsigned char *>(data)[i];
+        return result;
+    }
+};
+
+/// \brief Word-at-a-time 64-bit hash.
+/// Processes 8 bytes per step (MurmurHash3-style mixing of every word,
+/// final avalanche of the state).
+struct Word64 {
+    using result_type = std::uint64_t;
+
+    static constexpr std::uint64_t seed = 0x9E3779B97F4A7C15ull;
+
+    static constexpr std::uint64_t rotl(std::uint64_t x, int r) {
+        return (x << r) | (x >> (64 - r));
+    }
+
+    /// \brief Mixes one word into the state.
+    static constexpr std::uint64_t mix(std::uint64_t state,
+                                       std::uint64_t word) {
+        word *= 0x87C37B91114253D5ull;
+        word = rotl(word, 31);
+        word *= 0x4CF5AD432745937Full;
+        state ^= word;
+        return rotl(state, 27) * 5 + 0x52DCE729;
+    }
+
+    /// \brief Final avalanche, every input bit affects every output bit.
+    static constexpr std::uint64_t finalize(std::uint64_t state) {
+        state ^= state >> 33;
+        state *= 0xFF51AFD7ED558CCDull;
+        state ^= state >> 33;
+        state *= 0xC4CEB9FE1A85EC53ull;
+        state ^= state >> 33;
+        return state;
+    }
+
+    /// \brief Hash state before finalization.
+    static std::uint64_t state(const void *data, std::size_t size,
+                               std::uint64_t state = seed) {
+        auto bytes = static_cast<const unsigned char *>(data);
+        std::size_t i = 0;
+        for (; i + sizeof(std::uint64_t) <= size; i += sizeof(std::uint64_t)) {
+            std::uint64_t word;
+            std::memcpy(&word, bytes + i, sizeof(word));
+            state = mix(state, word);
+        }
+        if (i != size) {
+            std::uint64_t word = 0;
+            std::memcpy(&word, bytes + i, size - i);
+            state = mix(state, word);
+        }
+        return state ^ size;
+    }
+
+    static result_type hash(const void *data, std::size_t size) {
+        return finalize(state(data, size));
+    }
+};
+
+/// \brief Word-at-a-time 32-bit hash (::Word64 folded to 32 bits).
+struct Word32 {
+    using result_type = std::uint32_t;
+
+    static result_type hash(const void *data, std::size_t size) {
+        auto result = Word64::hash(data, size);
+        return static_cast<result_type>(result ^ (result >> 32));
+    }
+};
+
+} // namespace hashers
+
 /// \brief Computes a hash of the arbitrary value.
-template <class T>
-HashType hash(const T &data) {
-    std::size_t size = sizeof(data);
-    HashType result = 1;
-    for (std::size_t i = 0; i < size; ++i)
-        result =
-            hash_factor * result + reinterpret_cast<const HashType *>(&data)[i];
-    return result;
+template <class Hasher = hashers::Byte, class T>
+typename Hasher::result_type hash(const T &data) {
+    return Hasher::hash(&data, sizeof(data));
 }
 
 } // namespace safe_stack
+
+#endif // SAFE_STACK_HASH_H
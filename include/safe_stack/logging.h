@@ -0,0 +1,113 @@
+#ifndef SAFE_STACK_LOGGING_H
+#define SAFE_STACK_LOGGING_H
+
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+
+/// \brief Logging policies of the safe stack.
+/// Logger is a type with `static constexpr bool enabled` flag and
+/// `static void log(const Event &)` function. When `enabled` is false stack
+/// doesn't even build events, so logging compiles out entirely.
+namespace safe_stack::logging {
+
+/// \brief Kind of the logged operation.
+enum class Op : unsigned char {
+    construct,
+    copy,
+    move,
+    destroy,
+    push,
+    pop,
+    push_range,
+    pop_range,
+    batch,
+    reserve,
+    clear,
+    invalid_state,
+};
+
+/// \brief Snapshot of the stack after the operation.
+struct Event {
+    Op op;
+    const void *stack;
+    std::size_t size;
+    std::size_t capacity;
+    std::uint64_t hash;
+};
+
+/// \brief Returns a name of the operation.
+inline const char *to_string(Op op) {
+    switch (op) {
+    case Op::construct:
+        return "constructed";
+    case Op::copy:
+        return "copied";
+    case Op::move:
+        return "moved";
+    case Op::destroy:
+        return "destructed";
+    case Op::push:
+        return "push";
+    case Op::pop:
+        return "pop";
+    case Op::push_range:
+        return "push range";
+    case Op::pop_range:
+        return "pop range";
+    case Op::batch:
+        return "batch";
+    case Op::reserve:
+        return "reserve";
+    case Op::clear:
+        return "clear";
+    case Op::invalid_state:
+        return "invalid state";
+    }
+    return "unknown";
+}
+
+/// \brief Prints the event as one line of text (without line break).
+inline std::ostream &operator<<(std::ostream &out, const Event &event) {
+    return out << "Stack " << event.stack << ": " << to_string(event.op)
+               << " (size " << event.size << ", capacity " << event.capacity
+               << ", hash " << event.hash << ")";
+}
+
+/// \brief Doesn't log anything (default).
+struct None {
+    static constexpr bool enabled = false;
+
+    static void log(const Event &) noexcept {}
+};
+
+/// \brief Logs every event to `std::cerr`.
+struct Cerr {
+    static constexpr bool enabled = true;
+
+    static void log(const Event &event) { std::cerr << event << '\n'; }
+};
+
+/// \brief Logs every event to `std::clog` (buffered).
+struct Clog {
+    static constexpr bool enabled = true;
+
+    static void log(const Event &event) { std::clog << event << '\n'; }
+};
+
+/// \brief Passes every event to the user-provided `handler`.
+/// Nothing is logged while `handler` is `nullptr`.
+struct Callback {
+    static constexpr bool enabled = true;
+
+    static inline void (*handler)(const Event &) = nullptr;
+
+    static void log(const Event &event) {
+        if (handler != nullptr)
+            handler(event);
+    }
+};
+
+} // namespace safe_stack::logging
+
+#endif // SAFE_STACK_LOGGING_H
@@ -0,0 +1,75 @@
+#ifndef SAFE_STACK_MALLOC_ALLOCATOR_H
+#define SAFE_STACK_MALLOC_ALLOCATOR_H
+
+#include <cstddef>
+#include <cstdlib>
+#include <limits>
+#include <new> // for std::bad_alloc
+
+namespace safe_stack {
+
+/// \brief Allocator which uses `malloc` and can resize buffers in place.
+///
+/// Stack of trivially relocatable elements (see safe_stack::
+/// is_trivially_relocatable) grows with reallocate(), i.e. `realloc`: buffer
+/// is extended in place when possible, and big buffers are moved by
+/// remapping their pages (`mremap` in glibc) instead of copying.
+template <class T>
+class MallocAllocator {
+    static_assert(alignof(T) <= alignof(std::max_align_t),
+                  "malloc can't allocate over-aligned objects");
+
+public:
+    using value_type = T;
+
+    MallocAllocator() noexcept = default;
+
+    template <class U>
+    MallocAllocator(const MallocAllocator<U> &) noexcept {}
+
+    /// \brief Allocates memory for `n` objects.
+    /// \exception std::bad_alloc Memory cannot be allocated.
+    T *allocate(std::size_t n) {
+        return static_cast<T *>(check(std::malloc(bytes(n))));
+    }
+
+    /// \brief Frees memory allocated by allocate() or reallocate().
+    void deallocate(T *p, std::size_t) noexcept { std::free(p); }
+
+    /// \brief Resizes memory of `old_n` objects to fit `new_n` objects.
+    /// Objects are moved bytewise, so it can be used only for trivially
+    /// relocatable types.
+    /// \exception std::bad_alloc Memory cannot be allocated (old memory
+    /// stays untouched).
+    T *reallocate(T *p, std::size_t, std::size_t new_n) {
+        auto memory = std::realloc(static_cast<void *>(p), bytes(new_n));
+        return static_cast<T *>(check(memory));
+    }
+
+    template <class U>
+    bool operator==(const MallocAllocator<U> &) const noexcept {
+        return true;
+    }
+
+    template <class U>
+    bool operator!=(const MallocAllocator<U> &) const noexcept {
+        return false;
+    }
+
+private:
+    static std::size_t bytes(std::size_t n) {
+        if (n > std::numeric_limits<std::size_t>::max() / sizeof(T))
+            throw std::bad_alloc{};
+        return n == 0 ? 1 : n * sizeof(T);
+    }
+
+    static void *check(void *memory) {
+        if (memory == nullptr)
+            throw std::bad_alloc{};
+        return memory;
+    }
+};
+
+} // namespace safe_stack
+
+#endif // SAFE_STACK_MALLOC_ALLOCATOR_H
@@ -0,0 +1,116 @@
+#ifndef SAFE_STACK_MMAP_ALLOCATOR_H
+#define SAFE_STACK_MMAP_ALLOCATOR_H
+
+#include "safe_stack/malloc_allocator.h"
+#include "safe_stack/pages.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstring> // for std::memcpy
+#include <limits>
+#include <new> // for std::bad_alloc
+#include <sys/mman.h>
+
+namespace safe_stack {
+
+/// \brief Allocator which keeps big buffers in anonymous memory mappings and
+/// resizes them with `mremap`.
+///
+/// Buffers smaller than `Threshold` bytes are allocated with `malloc` (see
+/// ::MallocAllocator). Bigger buffers are mapped with `mmap`, and reallocate()
+/// grows them with `mremap(MREMAP_MAYMOVE)`: pages are remapped, not copied,
+/// so growing stack of trivially relocatable elements takes time proportional
+/// to the number of changed pages. Shrinking unmaps the freed pages, so
+/// memory is returned to the system immediately.
+///
+/// Works on Linux only.
+template <class T, std::size_t Threshold = (1 << 20)>
+class MmapAllocator {
+public:
+    using value_type = T;
+
+    /// \brief Buffers of at least this many bytes are mapped.
+    static constexpr std::size_t threshold = Threshold;
+
+    template <class U>
+    struct rebind {
+        using other = MmapAllocator<U, Threshold>;
+    };
+
+    MmapAllocator() noexcept = default;
+
+    template <class U>
+    MmapAllocator(const MmapAllocator<U, Threshold> &) noexcept {}
+
+    /// \brief Allocates memory for `n` objects.
+    /// \exception std::bad_alloc Memory cannot be allocated.
+    T *allocate(std::size_t n) {
+        auto size = bytes(n);
+        if (!mapped(size))
+            return MallocAllocator<T>{}.allocate(n);
+        void *memory = mmap(nullptr, detail::round_to_pages(size),
+                            PROT_READ | PROT_WRITE,
+                            MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (memory == MAP_FAILED)
+            throw std::bad_alloc{};
+        return static_cast<T *>(memory);
+    }
+
+    /// \brief Frees memory allocated by allocate() or reallocate().
+    void deallocate(T *p, std::size_t n) noexcept {
+        auto size = bytes(n);
+        if (mapped(size))
+            munmap(p, detail::round_to_pages(size));
+        else
+            MallocAllocator<T>{}.deallocate(p, n);
+    }
+
+    /// \brief Resizes memory of `old_n` objects to fit `new_n` objects.
+    /// Objects are moved bytewise, so it can be used only for trivially
+    /// relocatable types.
+    /// \exception std::bad_alloc Memory cannot be allocated (old memory
+    /// stays untouched).
+    T *reallocate(T *p, std::size_t old_n, std::size_t new_n) {
+        auto old_size = bytes(old_n);
+        auto new_size = bytes(new_n);
+        if (!mapped(old_size) && !mapped(new_size))
+            return MallocAllocator<T>{}.reallocate(p, old_n, new_n);
+        if (mapped(old_size) && mapped(new_size)) {
+            void *memory = mremap(p, detail::round_to_pages(old_size),
+                                  detail::round_to_pages(new_size),
+                                  MREMAP_MAYMOVE);
+            if (memory == MAP_FAILED)
+                throw std::bad_alloc{};
+            return static_cast<T *>(memory);
+        }
+
+        // buffer crosses the threshold
+        auto result = allocate(new_n);
+        std::memcpy(static_cast<void *>(result), static_cast<void *>(p),
+                    std::min(old_size, new_size));
+        deallocate(p, old_n);
+        return result;
+    }
+
+    template <class U>
+    bool operator==(const MmapAllocator<U, Threshold> &) const noexcept {
+        return true;
+    }
+
+    template <class U>
+    bool operator!=(const MmapAllocator<U, Threshold> &) const noexcept {
+        return false;
+    }
+
+private:
+    static std::size_t bytes(std::size_t n) {
+        if (n > std::numeric_limits<std::size_t>::max() / sizeof(T))
+            throw std::bad_alloc{};
+        return n * sizeof(T);
+    }
+
+    static bool mapped(std::size_t bytes) { return bytes >= Threshold; }
+};
+
+} // namespace safe_stack
+
+#endif // SAFE_STACK_MMAP_ALLOCATOR_H
@@ -0,0 +1,23 @@
+#ifndef SAFE_STACK_PAGES_H
+#define SAFE_STACK_PAGES_H
+
+#include <cstddef>
+#include <unistd.h>
+
+namespace safe_stack::detail {
+
+/// \brief Returns the size of the memory page.
+inline std::size_t page_size() {
+    static const auto size = static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+    return size;
+}
+
+/// \brief Rounds `bytes` up to the whole number of pages.
+inline std::size_t round_to_pages(std::size_t bytes) {
+    auto page = page_size();
+    return (bytes + page - 1) / page * page;
+}
+
+} // namespace safe_stack::detail
+
+#endif // SAFE_STACK_PAGES_H
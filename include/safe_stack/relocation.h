@@ -0,0 +1,31 @@
+#ifndef SAFE_STACK_RELOCATION_H
+#define SAFE_STACK_RELOCATION_H
+
+#include <memory>
+#include <type_traits>
+
+namespace safe_stack {
+
+/// \brief Checks if an object of type `T` can be moved to another place by
+/// copying its bytes (the source is then forgotten without its destructor).
+///
+/// Trivially copyable types are trivially relocatable. Other types may opt in
+/// by specializing this trait. Types which point into themselves (such as
+/// `std::string` with small string optimization in libstdc++) must not.
+template <class T>
+struct is_trivially_relocatable : std::is_trivially_copyable<T> {};
+
+template <class T, class Deleter>
+struct is_trivially_relocatable<std::unique_ptr<T, Deleter>>
+    : is_trivially_relocatable<Deleter> {};
+
+template <class T>
+struct is_trivially_relocatable<std::shared_ptr<T>> : std::true_type {};
+
+template <class T>
+inline constexpr bool is_trivially_relocatable_v =
+    is_trivially_relocatable<T>::value;
+
+} // namespace safe_stack
+
+#endif // SAFE_STACK_RELOCATION_H
@@ -1,22 +1,114 @@
 #ifndef SAFE_STACK_H
 #define SAFE_STACK_H
 
+#include "safe_stack/checks.h"
+#include "safe_stack/error.h"
+#include "safe_stack/growth.h"
 #include "safe_stack/hash.h"
+#include "safe_stack/logging.h"
+#include "safe_stack/relocation.h"
+#include "safe_stack/scrubber.h"
+#include <algorithm>
+#include <atomic>
 #include <cassert> // for assert
 #include <cstdint> // for std::uintptr_t
-#include <iostream>
+#include <cstring> // for std::memcpy
+#include <exception> // for std::uncaught_exceptions
+#include <functional> // for std::less
+#include <initializer_list>
+#include <iterator>
 #include <memory>
+#include <new> // for std::bad_alloc
+#include <optional>
+#include <ostream>
+#include <thread>
+#include <type_traits>
+#include <utility> // for std::exchange
+#include <vector>
 
 namespace safe_stack {
 
-/// \brief Thrown when something went wrong.
-struct StackError {};
+namespace detail {
 
-/// \brief Thrown when stack doesn't have enough elements.
-struct StackUnderflow : public StackError {};
+/// \brief Checks if `T` can be printed with `operator<<`.
+template <class T, class = void>
+struct is_streamable : std::false_type {};
 
-/// \brief Thrown when stack was in some incorrect state.
-struct StackInvalidState : public StackError {};
+template <class T>
+struct is_streamable<
+    T, std::void_t<decltype(std::declval<std::ostream &>()
+                            << std::declval<const T &>())>> : std::true_type {};
+
+/// \brief Prints `elem` if it is printable, otherwise prints placeholder.
+template <class T>
+void print_element(std::ostream &out, const T &elem) {
+    if constexpr (is_streamable<T>::value)
+        out << elem;
+    else
+        out << "<element>";
+}
+
+/// \brief State of sampled checks (see checks::Sampled).
+template <std::size_t Period, bool Random>
+struct Sampler {
+    /// Reads since the last full check or state of xorshift generator.
+    std::uint64_t state{Random ? 0x9E3779B97F4A7C15u : 0};
+    std::size_t period{Period};
+    std::uint64_t reads{0};
+    std::uint64_t full_checks{0};
+
+    /// \brief Counts the read and decides if it is fully checked.
+    bool sample() noexcept {
+        reads += 1;
+        bool full;
+        if constexpr (Random) {
+            state ^= state << 13;
+            state ^= state >> 7;
+            state ^= state << 17;
+            full = state % period == 0;
+        } else {
+            full = ++state >= period;
+            if (full)
+                state = 0;
+        }
+        full_checks += full;
+        return full;
+    }
+};
+
+/// \brief Checks if allocator `A` has
+/// `T *reallocate(T *p, std::size_t old_n, std::size_t new_n)`.
+template <class A, class T, class = void>
+struct has_reallocate : std::false_type {};
+
+template <class A, class T>
+struct has_reallocate<A, T,
+                      std::void_t<decltype(std::declval<A &>().reallocate(
+                          std::declval<T *>(), std::size_t{}, std::size_t{}))>>
+    : std::true_type {};
+
+/// \brief Checks if allocator `A` has
+/// `bool resize(T *p, std::size_t old_n, std::size_t new_n)`.
+template <class A, class T, class = void>
+struct has_resize : std::false_type {};
+
+template <class A, class T>
+struct has_resize<A, T,
+                  std::void_t<decltype(std::declval<A &>().resize(
+                      std::declval<T *>(), std::size_t{}, std::size_t{}))>>
+    : std::true_type {};
+
+} // namespace detail
+
+/// \brief Statistics of sampled checks (see checks::Sampled).
+struct ValidationStats {
+    /// \brief Number of checked reads.
+    std::uint64_t reads;
+    /// \brief Number of reads checked with the hash and elements.
+    std::uint64_t full_checks;
+    /// \brief Current sample period.
+    std::size_t sample_period;
+};
 
 /// \brief Safe stack class.
 /// Main design decisions:
@@ -27,12 +119,50 @@ struct StackInvalidState : public StackError {};
 /// 3. If object is moved out to a new place, it is marked as invalid
 /// (`size` becomes bigger than `capacity`). Any operation on invalid object
 /// throws ::StackInvalidState
-template <class T, class Allocator = std::allocator<T>>
+///
+/// Which checks are done is selected by `CheckPolicy` (see safe_stack::checks)
+/// at compile time, i.e. `Stack<T, std::allocator<T>, checks::None>` does no
+/// checks at all.
+///
+/// Every operation is reported to `Logger` (see safe_stack::logging). Default
+/// logger does nothing and compiles out.
+///
+/// Checksum is computed by `Hasher` (see safe_stack::hashers), its
+/// `result_type` is the type of the stored checksum.
+///
+/// When stack grows and shrinks is decided by `GrowthPolicy` (see
+/// safe_stack::growth).
+///
+/// Trivially relocatable elements (see safe_stack::is_trivially_relocatable)
+/// are moved to a new buffer with `memcpy`, or with `Allocator::reallocate`
+/// if it exists (see safe_stack::MallocAllocator). If `Allocator::resize`
+/// exists, buffer is resized in place and elements never move (see
+/// safe_stack::VirtualAllocator).
+///
+/// First `InlineCapacity` elements are stored inside the stack object (between
+/// its canaries), the allocator is used only when the stack grows bigger. The
+/// hash covers the inline elements except the top one (it may be changed
+/// through top()) instead of the whole inline buffer.
+///
+/// Stack isn't thread-safe (see safe_stack::ConcurrentStack), but its const
+/// member functions don't write to the stack, so they can be called
+/// concurrently. The exception is checks::Sampled policy (it counts reads).
+template <class T, class Allocator = std::allocator<T>,
+          class CheckPolicy = checks::Full, class Logger = logging::None,
+          class Hasher = hashers::Word64,
+          class GrowthPolicy = growth::Hysteresis,
+          std::size_t InlineCapacity = 0>
 class Stack {
 public:
+    /// \brief Type of the elements.
+    using value_type = T;
+
+    /// \brief Type of the checksum.
+    using HashType = typename Hasher::result_type;
+
     /// \brief Constructs an empty stack.
-    /// This function never fails.
-    Stack() noexcept;
+    /// This function never fails (if the stack isn't scrubbed).
+    Stack() noexcept(!CheckPolicy::scrubbed);
 
     /// \brief Constructs a copy of the stack.
     /// \exception ::InvalidStateError Argument was invalid.
@@ -69,6 +199,75 @@ public:
 
     const T &top() const;
 
+    /// \brief Removes the top element and returns it.
+    /// The element is moved out, the stack is validated and hashed once.
+    /// \exception ::StackUnderflow Stack was empty.
+    /// \exception ::StackInvalidState Stack was invalid.
+    T pop_value();
+
+    /// \brief Move-assigns the top element to `out` and removes it.
+    /// \exception ::StackUnderflow Stack was empty.
+    /// \exception ::StackInvalidState Stack was invalid.
+    void pop_into(T &out);
+
+    /// \brief Pushes elements of `[first, last)` to the end of the stack.
+    /// Buffer is reserved once (if the iterators are forward ones), the stack
+    /// is validated and hashed once. Trivially copyable elements are copied
+    /// with `memcpy` from pointers. The range may contain elements of the
+    /// stack itself.
+    /// \exception ::StackInvalidState The stack was invalid
+    template <class InputIt>
+    void push_range(InputIt first, InputIt last);
+
+    /// \brief Pushes `values` to the end of the stack (see push_range()).
+    void append(std::initializer_list<T> values);
+
+    /// \brief Removes `count` top elements.
+    /// \exception ::StackUnderflow Stack had less than `count` elements
+    /// (nothing is removed).
+    /// \exception ::StackInvalidState Stack was invalid.
+    void pop_n(std::size_t count);
+
+    /// \brief Moves `count` top elements to `out` (in the order of popping,
+    /// the top element first) and removes them.
+    /// \return Output iterator past the last moved element.
+    /// \exception ::StackUnderflow Stack had less than `count` elements
+    /// (nothing is removed).
+    /// \exception ::StackInvalidState Stack was invalid.
+    template <class OutputIt>
+    OutputIt pop_n_into(OutputIt out, std::size_t count);
+
+    /// \brief Pushes element to the end of the stack without exceptions.
+    /// Only exceptions of T's constructors (which are used to construct the
+    /// element and to move elements to a bigger buffer) are propagated.
+    /// \return Status::invalid_state if the stack was invalid,
+    /// Status::overflow if memory cannot be allocated.
+    Status try_push(const T &elem) noexcept(
+        std::is_nothrow_copy_constructible_v<T>
+            && std::is_nothrow_move_constructible_v<T>);
+
+    /// \brief Pushes element to the end of the stack without exceptions.
+    Status try_push(T &&elem) noexcept(std::is_nothrow_move_constructible_v<T>);
+
+    /// \brief Constructs element at the end of the stack without exceptions.
+    template <class... Args>
+    Status try_emplace(Args &&... args) noexcept(
+        std::is_nothrow_constructible_v<T, Args &&...>
+            && std::is_nothrow_move_constructible_v<T>);
+
+    /// \brief Removes the top element and returns it without exceptions.
+    /// \return std::nullopt if the stack was empty or invalid (see valid()).
+    std::optional<T> try_pop() noexcept(
+        std::is_nothrow_move_constructible_v<T>);
+
+    /// \brief Returns a pointer to the top element without exceptions.
+    /// \return nullptr if the stack was empty or invalid.
+    T *try_top() noexcept;
+
+    /// \brief Returns a pointer to the top element without exceptions.
+    /// \return nullptr if the stack was empty or invalid.
+    const T *try_top() const noexcept;
+
     /// \brief Allocates memory to store at least `new_capacity` elements
     /// without reallocation This function may fail in any of these cases:
     ///
@@ -94,274 +293,1726 @@ public:
 
     /// \brief Checks if the stack' internal representation is valid.
     /// Stack is valid if all these conditions holds:
-    /// 1. All canaries are correct
+    /// 1. All canaries are correct (including canaries in the buffer)
     /// 2. Hash is correct
     /// 1. \f$size \le capacity\f$
     /// 2. \f$capacity = 0 \Leftrightarrow data = \text{nullptr}\f$
+    /// Conditions disabled by `CheckPolicy` are not checked.
     /// \return if the stack is valid.
     inline bool valid() const;
 
+    /// \brief Sets sample period of checks::Sampled policy: only one of
+    /// `period` reads checks the hash and elements (0 is treated as 1).
+    void set_sample_period(std::size_t period) noexcept;
+
+    /// \brief Returns statistics of checks::Sampled policy.
+    ValidationStats stats() const noexcept;
+
+    /// \brief Validates the stack and, if `CheckPolicy::payload` is set,
+    /// checksum of its elements. It takes O(n) time, blocks of elements (if
+    /// `CheckPolicy::block_size` is set) are checked in parallel.
+    /// \exception ::StackInvalidState The stack or its elements were
+    /// corrupted.
+    void deep_validate() const;
+
+    /// \brief Sequence of operations on the stack checked as a whole.
+    ///
+    /// The stack is validated when the batch is created and rehashed and
+    /// validated once when it is committed (or destroyed). Operations of the
+    /// batch don't validate or hash the stack and aren't logged. Between them
+    /// the stored hash is stale, so the stack itself must not be used until
+    /// the batch ends. Fields changed inside the batch are protected only by
+    /// canaries and invariants: the new hash is computed from them (a lazy
+    /// hash is updated by every operation and checked when the batch ends).
+    class Batch {
+    public:
+        /// \brief Starts a batch.
+        /// \exception ::StackInvalidState The stack was invalid.
+        explicit Batch(Stack &stack);
+
+        Batch(const Batch &) = delete;
+        Batch &operator=(const Batch &) = delete;
+
+        /// \brief Commits the batch if it wasn't committed. Doesn't throw: if
+        /// the stack is invalid, Op::invalid_state is logged and the stack
+        /// stays invalid, its next operation throws. If the batch is
+        /// destroyed by an exception, the stack is only rehashed.
+        ~Batch();
+
+        void push(const T &elem);
+
+        void push(T &&elem);
+
+        template <class... Args>
+        void emplace(Args &&... args);
+
+        /// \exception ::StackUnderflow Stack was empty.
+        void pop();
+
+        /// \exception ::StackUnderflow Stack was empty.
+        T pop_value();
+
+        /// \exception ::StackUnderflow Stack was empty.
+        T &top();
+
+        std::size_t size() const noexcept { return _stack._size; }
+
+        bool empty() const noexcept { return _stack._size == 0; }
+
+        /// \brief Rehashes and validates the stack, shrinks its buffer.
+        /// Batch can't be used after the commit.
+        /// \exception ::StackInvalidState The stack was invalid.
+        void commit();
+
+    private:
+        /// \brief Ends the batch and rehashes the stack.
+        void finish() noexcept;
+
+        Stack &_stack;
+        int _exceptions; // uncaught exceptions when the batch was started
+        bool _active{true};
+        bool _writing{false}; // the batch started scrubber's write section
+    };
+
+    /// \brief Checks the stack including its lazy hash (see
+    /// checks::WithLazyHash) and starts a new interval of mutations.
+    /// \exception ::StackInvalidState The stack was invalid.
+    void checkpoint();
+
+    /// \brief Starts a batch of operations (see Stack::Batch).
+    /// \exception ::StackInvalidState The stack was invalid.
+    Batch batch() { return Batch{*this}; }
+
     /// \brief Helper function to print the stack's internal representation
-    template <class T2, class A2>
-    friend std::ostream &operator<<(std::ostream &out,
-                                    const Stack<T2, A2> &stack);
+    template <class T2, class A2, class C2, class L2, class H2, class G2,
+              std::size_t N2>
+    friend std::ostream &
+    operator<<(std::ostream &out,
+               const Stack<T2, A2, C2, L2, H2, G2, N2> &stack);
 
 private:
     using allocator_traits = std::allocator_traits<Allocator>;
 
-    static constexpr double growth_factor = 2;
-    static constexpr double shrink_factor = 0.4;
     static constexpr unsigned long long canary_value = 0xDEADBEEFBADF00Dul;
 
+    /// \brief Number of elements' slots taken by one buffer canary.
+    static constexpr std::size_t canary_slots =
+        CheckPolicy::buffer_canaries
+            ? (sizeof(canary_value) + sizeof(T) - 1) / sizeof(T)
+            : 0;
+
     decltype(canary_value) start_canary{canary_value};
-    T *_data{nullptr}; // todo: add guards to data
+    T *_data{nullptr}; // use GuardedAllocator to guard data with pages
     std::size_t _capacity{0};
-    mutable HashType _hash{0};
+    HashType _hash{0};
     std::size_t _size{0};
     Allocator _allocator;
+    /// Sum of checksums of all elements except the top one (top element may
+    /// be changed through top()). Exists only if `CheckPolicy::payload` set.
+    [[no_unique_address]] std::conditional_t<CheckPolicy::payload,
+                                             std::uint64_t, detail::Nothing<0>>
+        _payload{};
+    /// Checksums of blocks of `CheckPolicy::block_size` elements (their sum
+    /// equals `_payload`). Exists only if `CheckPolicy::block_size` is set.
+    [[no_unique_address]] std::conditional_t<CheckPolicy::block_size != 0,
+                                             std::uint64_t *,
+                                             detail::Nothing<1>>
+        _blocks{};
+    /// Buffer for `InlineCapacity` elements (and buffer canaries).
+    struct InlineBuffer {
+        alignas(T) unsigned char bytes[(InlineCapacity + 2 * canary_slots) *
+                                       sizeof(T)];
+    };
+    [[no_unique_address]] std::conditional_t<InlineCapacity != 0,
+                                             InlineBuffer, detail::Nothing<2>>
+        _inline;
+    /// Number of mutations since the lazy hash was checked (excluded from
+    /// the hash). Exists only if `CheckPolicy::lazy_hash` is set.
+    [[no_unique_address]] std::conditional_t<CheckPolicy::lazy_hash,
+                                             std::size_t, detail::Nothing<3>>
+        _pending{};
+    /// State of sampled checks (excluded from the hash). Exists only if
+    /// `CheckPolicy::sampled` is set.
+    [[no_unique_address]] mutable std::conditional_t<
+        CheckPolicy::sampled,
+        detail::Sampler<CheckPolicy::sample_period,
+                        CheckPolicy::random_sampling>,
+        detail::Nothing<4>>
+        _sampler{};
+    /// Seqlock state shared with the scrubber (excluded from the hash).
+    /// Exists only if `CheckPolicy::scrubbed` is set.
+    [[no_unique_address]] mutable std::conditional_t<
+        CheckPolicy::scrubbed, scrub::State, detail::Nothing<5>>
+        _scrub;
     decltype(canary_value) end_canary{canary_value};
 
+    static_assert(!CheckPolicy::scrubbed || InlineCapacity == 0,
+                  "scrubbed stack can't keep elements inline");
+    static_assert(!CheckPolicy::lazy_hash || InlineCapacity == 0,
+                  "stack with lazy hash can't keep elements inline");
+
+    /// \brief Write section of the scrubber's seqlock (does nothing if the
+    /// stack isn't scrubbed or the section is already started).
+    class Writing {
+    public:
+        explicit Writing(const Stack &stack) noexcept : _stack{stack} {
+            if constexpr (CheckPolicy::scrubbed)
+                _outer = _stack._scrub.begin_write();
+        }
+
+        Writing(const Writing &) = delete;
+        Writing &operator=(const Writing &) = delete;
+
+        ~Writing() {
+            if constexpr (CheckPolicy::scrubbed)
+                if (_outer)
+                    _stack._scrub.end_write();
+        }
+
+    private:
+        const Stack &_stack;
+        bool _outer{false};
+    };
+
+    /// \brief Registers the stack in the scrubber (if it is scrubbed).
+    void register_stack();
+
+    /// \brief Unregisters the stack from the scrubber (if it is scrubbed).
+    void unregister_stack() const;
+
+    /// \brief Waits until the scrubber stops reading the buffer (if the
+    /// stack is scrubbed). Must be called before the buffer is freed.
+    void wait_for_scrubber() const;
+
+    /// \brief Fields of the stack loaded by the scrubber.
+    struct Snapshot {
+        unsigned long long start_canary;
+        T *data;
+        std::size_t capacity;
+        HashType hash;
+        std::size_t size;
+        decltype(_payload) payload;
+        decltype(_blocks) blocks;
+        unsigned long long end_canary;
+    };
+
+    /// \brief Loads the fields with relaxed atomic loads (the owner may
+    /// change them meanwhile).
+    Snapshot snapshot() const;
+
+    /// \brief Checks the snapshot like `valid(true)` (`deep` - check
+    /// checksums of the elements too). Reads the buffer with relaxed atomic
+    /// loads.
+    bool snapshot_valid(const Snapshot &snapshot, bool deep) const;
+
+    /// \brief Checks the stack for the scrubber.
+    static scrub::Result scrub_check(const void *stack, bool deep);
+
     void clear_internal();
 
+    /// \brief Constructs new top element (there must be space for it).
+    /// Hash is not updated.
+    template <class... Args>
+    void construct_top(Args &&... args);
+
+    /// \brief Constructs new top element, grows the buffer if it is full.
+    /// `args` may refer to the stack's elements: before the old buffer is
+    /// freed, the element is constructed aside. Hash is not updated.
+    template <class... Args>
+    void emplace_top(Args &&... args);
+
+    /// \brief Destroys the top element (stack must not be empty).
+    /// Hash is not updated.
+    void destroy_top();
+
+    /// \brief Shrinks the buffer if `GrowthPolicy` wants it.
+    void shrink();
+
+    /// \brief Grows the buffer (following `GrowthPolicy`) to fit at least
+    /// `size` elements.
+    void grow_to(std::size_t size);
+
+    /// \brief Finishes push of `count` elements constructed at `_size`.
+    void pushed(std::size_t count);
+
+    /// \brief Removes `count` top elements (there must be enough of them).
+    /// Hash is not updated.
+    void destroy_top(std::size_t count);
+
+    /// \brief Updates checksums of the elements for the stack of `size`
+    /// elements (all of them except the top one are sealed). Elements between
+    /// the sizes must exist.
+    void update_payload(std::size_t size);
+
+    /// \brief Takes elements of `o` (this stack has no buffer), `o` becomes
+    /// invalid.
+    void take(Stack &o);
+
+    /// \brief Checks if the iterator points to an element of the stack.
+    template <class It>
+    bool contains(const It &it) const;
+
+    /// \brief Returns the inline buffer.
+    T *inline_data() const;
+
+    /// \brief Checks if `data` is the inline buffer.
+    bool is_inline(const T *data) const;
+
+    /// \brief Copies elements of `o` to this stack (which has no buffer).
+    void copy_elements(const Stack &o);
+
+    /// \brief Allocates buffer for `capacity` elements (and buffer canaries).
+    /// Inline buffer is used if it is free and big enough.
+    T *allocate_buffer(std::size_t capacity);
+
+    /// \brief Deallocates buffer allocated by allocate_buffer().
+    void deallocate_buffer(T *data, std::size_t capacity);
+
+    /// \brief Writes canaries around the buffer (if they are enabled).
+    static void write_buffer_canaries(T *data, std::size_t capacity);
+
+    /// \brief Resizes the buffer in place (if the allocator can do it).
+    /// \return if the buffer was resized.
+    bool resize_buffer(std::size_t capacity);
+
+    /// \brief Moves first `min(size, capacity)` elements bytewise to a buffer
+    /// for `capacity` elements (only for trivially relocatable elements).
+    /// Old buffer is deallocated, the rest of the elements are destroyed.
+    T *relocate_buffer(std::size_t capacity);
+
+    /// \brief Checks canaries around the buffer.
+    bool buffer_canaries_valid() const;
+
     void validate() const;
 
+    /// \brief Checks the stack like valid(), but the hash and elements are
+    /// checked only if `full` is set.
+    bool valid(bool full) const;
+
+    /// \brief Checks the stack before a read (the check is sampled if
+    /// `CheckPolicy::sampled` is set).
+    bool read_valid() const;
+
+    /// \brief Validates the stack before a read (see read_valid()).
+    /// \exception ::StackInvalidState The stack was invalid.
+    void validate_read() const;
+
+    /// \brief Checks the stack before (or after) a mutation. Lazy hash is
+    /// checked only at checkpoints (every `CheckPolicy::check_interval`
+    /// mutations).
+    bool mutation_valid();
+
+    /// \brief Validates the stack before a mutation (see mutation_valid()).
+    /// \exception ::StackInvalidState The stack was invalid.
+    void validate_mutation();
+
+    /// \brief Validates the stack after a mutation (only if
+    /// `CheckPolicy::on_exit` is set).
+    void revalidate();
+
+    /// \brief Updates stored hash after a mutation (only if
+    /// `CheckPolicy::hash` is set). Lazy hash is already updated, the
+    /// mutation is only counted.
+    void update_hash();
+
+    /// \brief Recomputes stored hash (even if it is lazy). Used when the
+    /// stack is created or its buffer is changed (the stack is validated
+    /// before that).
+    void rehash();
+
+    /// \brief Sets the number of elements (and updates lazy hash).
+    void set_size(std::size_t size);
+
+    /// \brief Adds `delta` to the checksum of the elements (and updates lazy
+    /// hash).
+    void add_payload(std::uint64_t delta);
+
+    /// \brief Returns a term of lazy hash for the field with value `value`.
+    static HashType field_hash(std::uint64_t field, std::uint64_t value);
+
     HashType compute_hash() const;
+
+    /// \brief Computes the hash of the stack with `data`, `size` and
+    /// `payload` fields. Bytes of the stack are copied by
+    /// `load(destination, source, size)`.
+    template <class Load>
+    HashType compute_hash(const T *data, std::size_t size,
+                          decltype(_payload) payload, Load load) const;
+
+    /// \brief Returns checksum of the element at `index` (depends on the
+    /// element's bytes and its position).
+    std::uint64_t element_hash(std::size_t index) const;
+
+    /// \brief Returns checksum of the element with bytes at `element`.
+    static std::uint64_t element_hash(const void *element, std::size_t index);
+
+    /// \brief Computes sum of checksums of all elements except the top one.
+    std::uint64_t compute_payload() const;
+
+    /// \brief Adds the element to the checksum of the elements.
+    void seal_element(std::size_t index);
+
+    /// \brief Removes the element from the checksum of the elements.
+    void unseal_element(std::size_t index);
+
+    /// \brief Computes checksums of the elements from scratch.
+    void rebuild_payload();
+
+    /// \brief Checks if the checksum of the elements is correct.
+    /// Blocks are checked by several threads if `parallel` is set (only
+    /// deep_validate() does it, checks of every operation are serial).
+    bool payload_valid(bool parallel = false) const;
+
+    /// Checksums of blocks take a few words, so allocators which resize
+    /// buffers in place (they reserve address space for every buffer, e.g.
+    /// VirtualAllocator) are replaced by `std::allocator` for them.
+    using block_allocator = std::conditional_t<
+        detail::has_resize<Allocator, T>::value, std::allocator<std::uint64_t>,
+        typename allocator_traits::template rebind_alloc<std::uint64_t>>;
+    using block_traits = std::allocator_traits<block_allocator>;
+
+    /// \brief Returns the allocator of checksums of blocks.
+    block_allocator get_block_allocator() const;
+
+    /// \brief Minimal number of blocks checked by one thread.
+    static constexpr std::size_t blocks_per_thread = 64;
+
+    /// \brief Returns a number of blocks for `capacity` elements.
+    static std::size_t block_count(std::size_t capacity);
+
+    /// \brief Allocates checksums of blocks for `capacity` elements: the
+    /// blocks kept from the current buffer are copied, others are zero. The
+    /// stack isn't changed.
+    std::uint64_t *allocate_blocks(std::size_t capacity);
+
+    /// \brief Frees checksums of blocks allocated for `capacity` elements.
+    void deallocate_blocks(std::uint64_t *blocks, std::size_t capacity);
+
+    /// \brief Checks the block if first `sealed` elements are sealed.
+    bool block_valid(std::size_t block, std::size_t sealed) const;
+
+    /// \brief Checks blocks from `first` to `last` (exclusive).
+    bool blocks_valid(std::size_t first, std::size_t last) const;
+
+    /// \brief Checks the block containing last sealed element (if any).
+    bool last_block_valid() const;
+
+    /// \brief Checks the block containing last sealed element (if any).
+    /// \exception ::StackInvalidState The block was corrupted.
+    void validate_last_block() const;
+
+    /// \brief Reports the operation to the logger (if it is enabled).
+    void log(logging::Op op) const;
 };
 
-template <class T, class A>
-Stack<T, A>::Stack() noexcept {
-    _hash = compute_hash();
-    std::cerr << "Stack " << this << ": default constructed!\n";
-    validate();
+template <class T, class A, class C, class L, class H, class G, std::size_t N>
+Stack<T, A, C, L, H, G, N>::Stack() noexcept(!C::scrubbed) {
+    rehash();
+    log(logging::Op::construct);
+    revalidate();
+    register_stack();
 }
 
-template <class T, class A>
-Stack<T, A>::Stack(const Stack &o) {
+template <class T, class A, class C, class L, class H, class G, std::size_t N>
+Stack<T, A, C, L, H, G, N>::Stack(const Stack &o) {
     o.validate();
 
-    _capacity = o._capacity;
-    _size = o._size;
-    _allocator = o._allocator;
-    _data = allocator_traits::allocate(_allocator, _capacity);
-    _hash = compute_hash();
-    std::uninitialized_copy_n(o._data, _size, _data);
-    std::cerr << "Stack " << this << ": copied from " << o << "\n";
+    copy_elements(o);
+    rehash();
+    log(logging::Op::copy);
 
-    validate();
+    revalidate();
+    register_stack();
 }
 
-template <class T, class A>
-Stack<T, A> &Stack<T, A>::operator=(const Stack &o) {
+template <class T, class A, class C, class L, class H, class G, std::size_t N>
+Stack<T, A, C, L, H, G, N> &
+Stack<T, A, C, L, H, G, N>::operator=(const Stack &o) {
     if (this == &o)
         return *this;
 
+    [[maybe_unused]] Writing writing{*this};
     validate();
     o.validate();
+    clear_internal();
 
-    _capacity = o._capacity;
-    _size = o._size;
-    _allocator = o._allocator;
-    _data = allocator_traits::allocate(_allocator, _capacity);
-    _hash = compute_hash();
-    std::uninitialized_copy_n(o._data, _size, _data);
-    std::cerr << "Stack " << this << ": copied from " << o
-              << " with assignment\n";
+    copy_elements(o);
+    rehash();
+    log(logging::Op::copy);
 
-    validate();
+    revalidate();
     return *this;
 }
 
-template <class T, class A>
-Stack<T, A>::Stack(Stack &&o) {
+template <class T, class A, class C, class L, class H, class G, std::size_t N>
+Stack<T, A, C, L, H, G, N>::Stack(Stack &&o) {
     o.validate();
 
-    _data = std::exchange(o._data, nullptr);
-    _capacity = std::exchange(o._capacity, 0);
-    _size = std::exchange(o._size, 1);
-    _allocator = std::move(o._allocator);
-    _hash = compute_hash();
-    std::cerr << "Stack " << this << ": moved from " << o << "\n";
+    take(o);
+    rehash();
+    log(logging::Op::move);
 
-    validate();
+    revalidate();
+    register_stack();
 }
 
-template <class T, class A>
-Stack<T, A> &Stack<T, A>::operator=(Stack &&o) {
+template <class T, class A, class C, class L, class H, class G, std::size_t N>
+Stack<T, A, C, L, H, G, N> &Stack<T, A, C, L, H, G, N>::operator=(Stack &&o) {
     if (this == &o)
         return *this;
 
+    [[maybe_unused]] Writing writing{*this};
     validate();
     o.validate();
     clear();
 
-    _data = std::exchange(o._data, nullptr);
-    _capacity = std::exchange(o._capacity, 0);
-    _size = std::exchange(o._size, 1);
-    _allocator = std::move(o._allocator);
-    _hash = compute_hash();
-    std::cerr << "Stack " << this << ": moved from " << o
-              << " with assignment\n";
+    take(o);
+    rehash();
+    log(logging::Op::move);
 
-    validate();
+    revalidate();
     return *this;
 }
 
-template <class T, class A>
-Stack<T, A>::~Stack() {
+template <class T, class A, class C, class L, class H, class G, std::size_t N>
+Stack<T, A, C, L, H, G, N>::~Stack() {
+    unregister_stack();
     if (valid()) {
         clear_internal();
-        std::cerr << "Stack " << this << ": destructed correctly\n";
+        log(logging::Op::destroy);
     } else {
-        std::cerr << "Stack " << this
-                  << ": cannot be destructed, because of incorrect state\n";
+        log(logging::Op::invalid_state);
     }
 }
 
-template <class T, class A>
-void Stack<T, A>::push(const T &elem) {
+template <class T, class A, class C, class L, class H, class G, std::size_t N>
+void Stack<T, A, C, L, H, G, N>::push(const T &elem) {
     return emplace(elem);
 }
 
-template <class T, class A>
-void Stack<T, A>::push(T &&elem) {
+template <class T, class A, class C, class L, class H, class G, std::size_t N>
+void Stack<T, A, C, L, H, G, N>::push(T &&elem) {
     return emplace(std::move(elem));
 }
 
-template <class T, class A>
+template <class T, class A, class C, class L, class H, class G, std::size_t N>
 template <class... Args>
-void Stack<T, A>::emplace(Args &&... args) {
-    validate();
+void Stack<T, A, C, L, H, G, N>::emplace(Args &&... args) {
+    [[maybe_unused]] Writing writing{*this};
+    validate_mutation();
+
+    emplace_top(std::forward<Args>(args)...);
+    update_hash();
+    log(logging::Op::push);
+    revalidate();
+}
 
-    if (_size == _capacity)
-        reserve(_capacity * growth_factor + 1);
+template <class T, class A, class C, class L, class H, class G, std::size_t N>
+void Stack<T, A, C, L, H, G, N>::pop() {
+    [[maybe_unused]] Writing writing{*this};
+    validate_mutation();
+    if (_size == 0)
+        throw StackUnderflow{};
 
-    allocator_traits::construct(_allocator, _data + _size,
-                                std::forward<Args>(args)...);
-    _size = _size + 1;
-    _hash = compute_hash();
-    std::cerr << "Stack " << this << ": add element " << _data[_size - 1]
-              << "\n";
-    validate();
+    destroy_top();
+    update_hash();
+    log(logging::Op::pop);
+    shrink();
+    revalidate();
 }
 
-template <class T, class A>
-void Stack<T, A>::pop() {
-    validate();
+template <class T, class A, class C, class L, class H, class G, std::size_t N>
+T &Stack<T, A, C, L, H, G, N>::top() {
+    validate_read();
     if (_size == 0)
         throw StackUnderflow{};
+    validate_last_block();
 
-    _size = _size - 1;
-    _hash = compute_hash();
-    std::cerr << "Stack " << this << ": pop element " << _data[_size] << "\n";
-    allocator_traits::destroy(_allocator, _data + _size);
-    if ((double)_size / _capacity < shrink_factor)
-        reserve(_size);
-    validate();
+    return _data[_size - 1];
 }
 
-template <class T, class A>
-T &Stack<T, A>::top() {
-    validate();
+template <class T, class A, class C, class L, class H, class G, std::size_t N>
+const T &Stack<T, A, C, L, H, G, N>::top() const {
+    validate_read();
     if (_size == 0)
         throw StackUnderflow{};
+    validate_last_block();
 
     return _data[_size - 1];
 }
 
-template <class T, class A>
-const T &Stack<T, A>::top() const {
-    return top();
+template <class T, class A, class C, class L, class H, class G, std::size_t N>
+T Stack<T, A, C, L, H, G, N>::pop_value() {
+    [[maybe_unused]] Writing writing{*this};
+    validate_mutation();
+    if (_size == 0)
+        throw StackUnderflow{};
+
+    T result{std::move(_data[_size - 1])};
+    destroy_top();
+    update_hash();
+    log(logging::Op::pop);
+    shrink();
+    revalidate();
+    return result;
+}
+
+template <class T, class A, class C, class L, class H, class G, std::size_t N>
+void Stack<T, A, C, L, H, G, N>::pop_into(T &out) {
+    [[maybe_unused]] Writing writing{*this};
+    validate_mutation();
+    if (_size == 0)
+        throw StackUnderflow{};
+
+    out = std::move(_data[_size - 1]);
+    destroy_top();
+    update_hash();
+    log(logging::Op::pop);
+    shrink();
+    revalidate();
+}
+
+template <class T, class A, class C, class L, class H, class G, std::size_t N>
+template <class InputIt>
+void Stack<T, A, C, L, H, G, N>::push_range(InputIt first, InputIt last) {
+    using category = typename std::iterator_traits<InputIt>::iterator_category;
+    using source = typename std::iterator_traits<InputIt>::value_type;
+    [[maybe_unused]] Writing writing{*this};
+    validate_mutation();
+
+    if constexpr (std::is_base_of_v<std::forward_iterator_tag, category>) {
+        auto count = static_cast<std::size_t>(std::distance(first, last));
+        if (count == 0)
+            return;
+        if (_size + count > _capacity && contains(first)) {
+            // the range would be freed by reallocation before it is read
+            std::vector<T> copy(first, last);
+            return push_range(copy.data(), copy.data() + count);
+        }
+        grow_to(_size + count);
+        if constexpr (std::is_pointer_v<InputIt> &&
+                      std::is_same_v<std::remove_cv_t<source>, T> &&
+                      std::is_trivially_copyable_v<T>)
+            std::memcpy(_data + _size, first, count * sizeof(T));
+        else
+            std::uninitialized_copy_n(first, count, _data + _size);
+        pushed(count);
+    } else {
+        auto old_size = _size;
+        try {
+            for (; first != last; ++first)
+                emplace_top(*first);
+        } catch (...) {
+            update_hash();
+            throw;
+        }
+        if (_size == old_size)
+            return;
+        update_hash();
+        log(logging::Op::push_range);
+    }
+    revalidate();
+}
+
+template <class T, class A, class C, class L, class H, class G, std::size_t N>
+void Stack<T, A, C, L, H, G, N>::append(std::initializer_list<T> values) {
+    push_range(values.begin(), values.end());
+}
+
+template <class T, class A, class C, class L, class H, class G, std::size_t N>
+void Stack<T, A, C, L, H, G, N>::pop_n(std::size_t count) {
+    [[maybe_unused]] Writing writing{*this};
+    validate_mutation();
+    if (count > _size)
+        throw StackUnderflow{};
+    if (count == 0)
+        return;
+
+    destroy_top(count);
+    update_hash();
+    log(logging::Op::pop_range);
+    shrink();
+    revalidate();
+}
+
+template <class T, class A, class C, class L, class H, class G, std::size_t N>
+template <class OutputIt>
+OutputIt Stack<T, A, C, L, H, G, N>::pop_n_into(OutputIt out,
+                                                std::size_t count) {
+    [[maybe_unused]] Writing writing{*this};
+    validate_mutation();
+    if (count > _size)
+        throw StackUnderflow{};
+    if (count == 0)
+        return out;
+
+    // elements are unsealed before they are moved out (moved-from elements
+    // have other bytes)
+    auto new_size = _size - count;
+    update_payload(new_size);
+    auto size = _size;
+    try {
+        for (; size != new_size; --size, ++out) {
+            *out = std::move(_data[size - 1]);
+            allocator_traits::destroy(_allocator, _data + size - 1);
+        }
+    } catch (...) {
+        // elements which weren't moved out stay in the stack
+        set_size(new_size);
+        update_payload(size);
+        set_size(size);
+        update_hash();
+        throw;
+    }
+    set_size(new_size);
+    update_hash();
+    log(logging::Op::pop_range);
+    shrink();
+    revalidate();
+    return out;
+}
+
+template <class T, class A, class C, class L, class H, class G, std::size_t N>
+void Stack<T, A, C, L, H, G, N>::checkpoint() {
+    [[maybe_unused]] Writing writing{*this};
+    validate();
+    if constexpr (C::lazy_hash)
+        _pending = 0;
+}
+
+template <class T, class A, class C, class L, class H, class G, std::size_t N>
+Stack<T, A, C, L, H, G, N>::Batch::Batch(Stack &stack)
+    : _stack{stack}, _exceptions{std::uncaught_exceptions()} {
+    _stack.validate();
+    if constexpr (C::scrubbed) // the whole batch is one write section
+        _writing = _stack._scrub.begin_write();
+}
+
+template <class T, class A, class C, class L, class H, class G, std::size_t N>
+Stack<T, A, C, L, H, G, N>::Batch::~Batch() {
+    if (!_active)
+        return;
+    finish();
+    if (std::uncaught_exceptions() > _exceptions)
+        return;
+    if (!_stack.valid()) {
+        _stack.log(logging::Op::invalid_state);
+        return;
+    }
+    _stack.log(logging::Op::batch);
+    try {
+        _stack.shrink();
+    } catch (...) { // the stack keeps its buffer
+    }
+}
+
+template <class T, class A, class C, class L, class H, class G, std::size_t N>
+void Stack<T, A, C, L, H, G, N>::Batch::push(const T &elem) {
+    emplace(elem);
+}
+
+template <class T, class A, class C, class L, class H, class G, std::size_t N>
+void Stack<T, A, C, L, H, G, N>::Batch::push(T &&elem) {
+    emplace(std::move(elem));
+}
+
+template <class T, class A, class C, class L, class H, class G, std::size_t N>
+template <class... Args>
+void Stack<T, A, C, L, H, G, N>::Batch::emplace(Args &&... args) {
+    assert(_active);
+    _stack.emplace_top(std::forward<Args>(args)...);
+}
+
+template <class T, class A, class C, class L, class H, class G, std::size_t N>
+void Stack<T, A, C, L, H, G, N>::Batch::pop() {
+    assert(_active);
+    if (_stack._size == 0)
+        throw StackUnderflow{};
+    _stack.destroy_top();
+}
+
+template <class T, class A, class C, class L, class H, class G, std::size_t N>
+T Stack<T, A, C, L, H, G, N>::Batch::pop_value() {
+    assert(_active);
+    if (_stack._size == 0)
+        throw StackUnderflow{};
+    T result{std::move(_stack._data[_stack._size - 1])};
+    _stack.destroy_top();
+    return result;
+}
+
+template <class T, class A, class C, class L, class H, class G, std::size_t N>
+T &Stack<T, A, C, L, H, G, N>::Batch::top() {
+    assert(_active);
+    if (_stack._size == 0)
+        throw StackUnderflow{};
+    return _stack._data[_stack._size - 1];
+}
+
+template <class T, class A, class C, class L, class H, class G, std::size_t N>
+void Stack<T, A, C, L, H, G, N>::Batch::commit() {
+    if (!_active)
+        return;
+    finish();
+    _stack.validate();
+    _stack.log(logging::Op::batch);
+    _stack.shrink();
+}
+
+template <class T, class A, class C, class L, class H, class G, std::size_t N>
+void Stack<T, A, C, L, H, G, N>::Batch::finish() noexcept {
+    _active = false;
+    _stack.update_hash();
+    if constexpr (C::scrubbed)
+        if (_writing)
+            _stack._scrub.end_write();
+}
+
+template <class T, class A, class C, class L, class H, class G, std::size_t N>
+Status Stack<T, A, C, L, H, G, N>::try_push(const T &elem) noexcept(
+    std::is_nothrow_copy_constructible_v<T>
+        && std::is_nothrow_move_constructible_v<T>) {
+    return try_emplace(elem);
+}
+
+template <class T, class A, class C, class L, class H, class G, std::size_t N>
+Status Stack<T, A, C, L, H, G, N>::try_push(T &&elem) noexcept(
+    std::is_nothrow_move_constructible_v<T>) {
+    return try_emplace(std::move(elem));
+}
+
+template <class T, class A, class C, class L, class H, class G, std::size_t N>
+template <class... Args>
+Status Stack<T, A, C, L, H, G, N>::try_emplace(Args &&... args) noexcept(
+    std::is_nothrow_constructible_v<T, Args &&...>
+        && std::is_nothrow_move_constructible_v<T>) {
+    [[maybe_unused]] Writing writing{*this};
+    if (!mutation_valid()) {
+        log(logging::Op::invalid_state);
+        return Status::invalid_state;
+    }
+
+    if (_size == _capacity) {
+        // args may refer to an element of the buffer which reserve() frees
+        T value(std::forward<Args>(args)...);
+        try {
+            reserve(G::grow(_capacity));
+        } catch (const std::bad_alloc &) {
+            return Status::overflow;
+        } catch (const StackError &) {
+            return Status::invalid_state;
+        }
+        construct_top(std::move(value));
+    } else {
+        construct_top(std::forward<Args>(args)...);
+    }
+    update_hash();
+    log(logging::Op::push);
+    if constexpr (C::on_exit)
+        if (!mutation_valid())
+            return Status::invalid_state;
+    return Status::ok;
+}
+
+template <class T, class A, class C, class L, class H, class G, std::size_t N>
+std::optional<T> Stack<T, A, C, L, H, G, N>::try_pop() noexcept(
+    std::is_nothrow_move_constructible_v<T>) {
+    [[maybe_unused]] Writing writing{*this};
+    if (!mutation_valid()) {
+        log(logging::Op::invalid_state);
+        return std::nullopt;
+    }
+    if (_size == 0)
+        return std::nullopt;
+
+    std::optional<T> result{std::move(_data[_size - 1])};
+    destroy_top();
+    update_hash();
+    log(logging::Op::pop);
+    try {
+        shrink();
+    } catch (...) {
+        // buffer stays bigger, the next operation checks the stack
+    }
+    return result;
+}
+
+template <class T, class A, class C, class L, class H, class G, std::size_t N>
+T *Stack<T, A, C, L, H, G, N>::try_top() noexcept {
+    return const_cast<T *>(std::as_const(*this).try_top());
+}
+
+template <class T, class A, class C, class L, class H, class G, std::size_t N>
+const T *Stack<T, A, C, L, H, G, N>::try_top() const noexcept {
+    // the same checks as top(), reported with nullptr
+    if (!read_valid()) {
+        log(logging::Op::invalid_state);
+        return nullptr;
+    }
+    if (_size == 0 || !last_block_valid())
+        return nullptr;
+    return _data + _size - 1;
 }
 
-template <class T, class A>
-void Stack<T, A>::reserve(std::size_t new_capacity) {
+template <class T, class A, class C, class L, class H, class G, std::size_t N>
+void Stack<T, A, C, L, H, G, N>::reserve(std::size_t new_capacity) {
+    [[maybe_unused]] Writing writing{*this};
     validate();
     if (new_capacity == 0)
         return clear_internal();
+    wait_for_scrubber();
+    if constexpr (N != 0) {
+        if (new_capacity <= N) {
+            if (is_inline(_data))
+                return;
+            new_capacity = N; // inline buffer is used
+        }
+    }
 
-    auto new_size = std::min(_capacity, _size);
-    auto new_data = allocator_traits::allocate(_allocator, new_capacity, _data);
-    if (_data != nullptr) {
-        std::uninitialized_move_n(_data, new_size, new_data);
-        std::destroy_n(_data, _size);
-        allocator_traits::deallocate(_allocator, _data, _capacity);
+    auto new_size = std::min(new_capacity, _size);
+    // everything that may fail is done before the old buffer is freed, so
+    // the stack isn't changed if an allocation or a move throws
+    auto new_blocks = allocate_blocks(new_capacity);
+    T *new_data = nullptr;
+    bool in_place = false;
+    try {
+        in_place = resize_buffer(new_capacity);
+        if (in_place) {
+            new_data = _data;
+        } else if constexpr (is_trivially_relocatable_v<T>) {
+            new_data = relocate_buffer(new_capacity);
+        } else {
+            new_data = allocate_buffer(new_capacity);
+            if (_data != nullptr) {
+                try {
+                    std::uninitialized_move_n(_data, new_size, new_data);
+                } catch (...) {
+                    deallocate_buffer(new_data, new_capacity);
+                    throw;
+                }
+                std::destroy_n(_data, _size);
+                deallocate_buffer(_data, _capacity);
+            }
+        }
+    } catch (...) {
+        deallocate_blocks(new_blocks, new_capacity);
+        throw;
+    }
+    if constexpr (C::block_size != 0) {
+        deallocate_blocks(_blocks, _capacity);
+        _blocks = new_blocks;
     }
-    std::cerr << "Stack " << this << ": resized from " << _capacity << " to "
-              << new_capacity << "\n";
+    // elements left in place or relocated keep their bytes and positions, so
+    // their checksums stay the same, moved elements may have different bytes
+    bool same_elements =
+        in_place || (is_trivially_relocatable_v<T> && new_size == _size);
     _capacity = new_capacity;
     _size = new_size;
     _data = new_data;
-    _hash = compute_hash();
-    validate();
+    if (!same_elements)
+        rebuild_payload();
+    rehash();
+    log(logging::Op::reserve);
+    revalidate();
 }
 
-template <class T, class A>
-void Stack<T, A>::clear() {
+template <class T, class A, class C, class L, class H, class G, std::size_t N>
+void Stack<T, A, C, L, H, G, N>::clear() {
+    [[maybe_unused]] Writing writing{*this};
     validate();
     clear_internal();
-    std::cerr << "Stack " << this << ": cleared\n";
-    validate();
+    log(logging::Op::clear);
+    revalidate();
 }
 
-template <class T, class A>
-std::size_t Stack<T, A>::size() const {
-    validate();
+template <class T, class A, class C, class L, class H, class G, std::size_t N>
+std::size_t Stack<T, A, C, L, H, G, N>::size() const {
+    validate_read();
     return _size;
 }
 
-template <class T, class A>
-inline bool Stack<T, A>::empty() const {
+template <class T, class A, class C, class L, class H, class G, std::size_t N>
+inline bool Stack<T, A, C, L, H, G, N>::empty() const {
     return size() == 0;
 }
 
-template <class T, class A>
-inline bool Stack<T, A>::valid() const {
-    return start_canary == canary_value && end_canary == canary_value &&
-           _hash == compute_hash() && _size <= _capacity &&
-           ((_capacity == 0 && _data == nullptr) ||
-            (_capacity != 0 && _data != nullptr));
+template <class T, class A, class C, class L, class H, class G, std::size_t N>
+inline bool Stack<T, A, C, L, H, G, N>::valid() const {
+    return valid(true);
+}
+
+template <class T, class A, class C, class L, class H, class G, std::size_t N>
+void Stack<T, A, C, L, H, G, N>::set_sample_period(
+    std::size_t period) noexcept {
+    static_assert(C::sampled, "checks are not sampled");
+    _sampler.period = std::max<std::size_t>(period, 1);
+    _sampler.state = C::random_sampling ? _sampler.state | 1 : 0;
+}
+
+template <class T, class A, class C, class L, class H, class G, std::size_t N>
+ValidationStats Stack<T, A, C, L, H, G, N>::stats() const noexcept {
+    static_assert(C::sampled, "checks are not sampled");
+    return {_sampler.reads, _sampler.full_checks, _sampler.period};
+}
+
+template <class T, class A, class C, class L, class H, class G, std::size_t N>
+inline bool Stack<T, A, C, L, H, G, N>::valid(bool full) const {
+    if constexpr (C::canaries)
+        if (start_canary != canary_value || end_canary != canary_value)
+            return false;
+    if constexpr (C::hash)
+        if (full && _hash != compute_hash())
+            return false;
+    if constexpr (C::invariants)
+        if (_size > _capacity || (_capacity == 0) != (_data == nullptr))
+            return false;
+    if constexpr (C::buffer_canaries)
+        if (_size <= _capacity && !buffer_canaries_valid())
+            return false;
+    if constexpr (C::deep)
+        return !full || payload_valid();
+    return true;
 }
 
-template <class T, class A>
-void Stack<T, A>::clear_internal() {
+template <class T, class A, class C, class L, class H, class G, std::size_t N>
+inline bool Stack<T, A, C, L, H, G, N>::read_valid() const {
+    bool full = !C::lazy_hash || C::check_on_read;
+    if constexpr (C::sampled)
+        full = full && _sampler.sample();
+    return valid(full);
+}
+
+template <class T, class A, class C, class L, class H, class G, std::size_t N>
+inline bool Stack<T, A, C, L, H, G, N>::mutation_valid() {
+    if constexpr (C::lazy_hash) {
+        bool full = C::check_interval != 0 && _pending >= C::check_interval;
+        if (!valid(full))
+            return false;
+        if (full)
+            _pending = 0;
+        return true;
+    }
+    return valid(true);
+}
+
+template <class T, class A, class C, class L, class H, class G, std::size_t N>
+void Stack<T, A, C, L, H, G, N>::deep_validate() const {
+    validate();
+    if (!payload_valid(true)) {
+        log(logging::Op::invalid_state);
+        throw StackInvalidState{};
+    }
+}
+
+template <class T, class A, class C, class L, class H, class G, std::size_t N>
+void Stack<T, A, C, L, H, G, N>::clear_internal() {
     if (_data != nullptr) {
+        wait_for_scrubber();
         std::destroy_n(_data, _size);
-        allocator_traits::deallocate(_allocator, _data, _capacity);
+        deallocate_buffer(_data, _capacity);
+        if constexpr (C::block_size != 0)
+            deallocate_blocks(std::exchange(_blocks, nullptr), _capacity);
         _data = nullptr;
         _capacity = 0;
         _size = 0; // stack becomes invalid if size > capacity
-        _hash = compute_hash();
+        if constexpr (C::payload)
+            _payload = 0;
+        rehash();
     }
-    validate();
+    revalidate();
+}
+
+template <class T, class A, class C, class L, class H, class G, std::size_t N>
+template <class... Args>
+void Stack<T, A, C, L, H, G, N>::construct_top(Args &&... args) {
+    allocator_traits::construct(_allocator, _data + _size,
+                                std::forward<Args>(args)...);
+    if constexpr (C::payload)
+        if (_size != 0) // old top element can't be changed anymore
+            seal_element(_size - 1);
+    set_size(_size + 1);
+}
+
+template <class T, class A, class C, class L, class H, class G, std::size_t N>
+template <class... Args>
+void Stack<T, A, C, L, H, G, N>::emplace_top(Args &&... args) {
+    if (_size != _capacity)
+        return construct_top(std::forward<Args>(args)...);
+    // args may refer to an element of the buffer which reserve() frees
+    T value(std::forward<Args>(args)...);
+    update_hash(); // reserve() validates the stack
+    reserve(G::grow(_capacity));
+    construct_top(std::move(value));
+}
+
+template <class T, class A, class C, class L, class H, class G, std::size_t N>
+void Stack<T, A, C, L, H, G, N>::destroy_top() {
+    set_size(_size - 1);
+    if constexpr (C::payload)
+        if (_size != 0) // new top element can be changed
+            unseal_element(_size - 1);
+    allocator_traits::destroy(_allocator, _data + _size);
 }
 
-template <class T, class A>
-inline void Stack<T, A>::validate() const {
+template <class T, class A, class C, class L, class H, class G, std::size_t N>
+void Stack<T, A, C, L, H, G, N>::shrink() {
+    auto new_capacity = G::shrink(_size, _capacity);
+    if (new_capacity != _capacity)
+        reserve(new_capacity);
+}
+
+template <class T, class A, class C, class L, class H, class G, std::size_t N>
+void Stack<T, A, C, L, H, G, N>::grow_to(std::size_t size) {
+    if (size <= _capacity)
+        return;
+    auto new_capacity = _capacity;
+    while (new_capacity < size)
+        new_capacity = G::grow(new_capacity);
+    reserve(new_capacity);
+}
+
+template <class T, class A, class C, class L, class H, class G, std::size_t N>
+void Stack<T, A, C, L, H, G, N>::pushed(std::size_t count) {
+    update_payload(_size + count);
+    set_size(_size + count);
+    update_hash();
+    log(logging::Op::push_range);
+}
+
+template <class T, class A, class C, class L, class H, class G, std::size_t N>
+void Stack<T, A, C, L, H, G, N>::destroy_top(std::size_t count) {
+    auto new_size = _size - count;
+    update_payload(new_size);
+    std::destroy_n(_data + new_size, count);
+    set_size(new_size);
+}
+
+template <class T, class A, class C, class L, class H, class G, std::size_t N>
+void Stack<T, A, C, L, H, G, N>::update_payload(std::size_t size) {
+    if constexpr (C::payload) {
+        // elements from the lower top element up to the higher one change
+        auto sealed = [](std::size_t n) { return n != 0 ? n - 1 : 0; };
+        for (auto i = sealed(_size); i < sealed(size); ++i)
+            seal_element(i);
+        for (auto i = sealed(size); i < sealed(_size); ++i)
+            unseal_element(i);
+    }
+}
+
+template <class T, class A, class C, class L, class H, class G, std::size_t N>
+void Stack<T, A, C, L, H, G, N>::take(Stack &o) {
+    o.unregister_stack(); // moved-out stack is invalid
+    _allocator = std::move(o._allocator);
+    if (o.is_inline(o._data)) {
+        _data = allocate_buffer(o._capacity);
+        std::uninitialized_move_n(o._data, o._size, _data);
+        std::destroy_n(o._data, o._size);
+        o._data = nullptr;
+    } else {
+        _data = std::exchange(o._data, nullptr);
+    }
+    _capacity = std::exchange(o._capacity, 0);
+    _size = std::exchange(o._size, 1);
+    if constexpr (C::payload)
+        _payload = o._payload;
+    if constexpr (C::block_size != 0)
+        _blocks = std::exchange(o._blocks, nullptr);
+    if constexpr (!is_trivially_relocatable_v<T>)
+        if (is_inline(_data)) // moved elements may have different bytes
+            rebuild_payload();
+}
+
+template <class T, class A, class C, class L, class H, class G, std::size_t N>
+template <class It>
+bool Stack<T, A, C, L, H, G, N>::contains(const It &it) const {
+    using reference = typename std::iterator_traits<It>::reference;
+    using element = std::remove_cv_t<std::remove_reference_t<reference>>;
+    if constexpr (std::is_reference_v<reference> &&
+                  std::is_same_v<element, T>) {
+        auto ptr = std::addressof(static_cast<const T &>(*it));
+        std::less<const T *> less;
+        return !less(ptr, _data) && less(ptr, _data + _size);
+    }
+    return false;
+}
+
+template <class T, class A, class C, class L, class H, class G, std::size_t N>
+T *Stack<T, A, C, L, H, G, N>::inline_data() const {
+    if constexpr (N != 0) {
+        auto bytes = const_cast<unsigned char *>(_inline.bytes);
+        return reinterpret_cast<T *>(bytes) + canary_slots;
+    }
+    return nullptr;
+}
+
+template <class T, class A, class C, class L, class H, class G, std::size_t N>
+bool Stack<T, A, C, L, H, G, N>::is_inline(const T *data) const {
+    if constexpr (N != 0)
+        return data == inline_data();
+    return false;
+}
+
+template <class T, class A, class C, class L, class H, class G, std::size_t N>
+void Stack<T, A, C, L, H, G, N>::copy_elements(const Stack &o) {
+    _allocator = o._allocator;
+    if constexpr (C::block_size != 0)
+        _blocks = allocate_blocks(o._capacity); // this stack has no buffer
+    _capacity = o._capacity;
+    _size = o._size;
+    if (_capacity != 0)
+        _data = allocate_buffer(_capacity);
+    if constexpr (std::is_trivially_copyable_v<T>) {
+        // copies have the same bytes at the same positions, so checksums are
+        // copied too (and corrupted elements stay detectable)
+        if (_size != 0)
+            std::memcpy(_data, o._data, _size * sizeof(T));
+        if constexpr (C::payload)
+            _payload = o._payload;
+        if constexpr (C::block_size != 0)
+            std::copy_n(o._blocks, block_count(_capacity), _blocks);
+    } else {
+        std::uninitialized_copy_n(o._data, _size, _data);
+        rebuild_payload();
+    }
+}
+
+template <class T, class A, class C, class L, class H, class G, std::size_t N>
+T *Stack<T, A, C, L, H, G, N>::allocate_buffer(std::size_t capacity) {
+    if constexpr (N != 0) {
+        if (capacity <= N && !is_inline(_data)) {
+            auto data = inline_data();
+            write_buffer_canaries(data, capacity);
+            return data;
+        }
+    }
+    auto buffer =
+        allocator_traits::allocate(_allocator, capacity + 2 * canary_slots);
+    auto data = buffer + canary_slots;
+    write_buffer_canaries(data, capacity);
+    return data;
+}
+
+template <class T, class A, class C, class L, class H, class G, std::size_t N>
+void Stack<T, A, C, L, H, G, N>::deallocate_buffer(T *data,
+                                                   std::size_t capacity) {
+    if (is_inline(data))
+        return;
+    allocator_traits::deallocate(_allocator, data - canary_slots,
+                                 capacity + 2 * canary_slots);
+}
+
+template <class T, class A, class C, class L, class H, class G, std::size_t N>
+void Stack<T, A, C, L, H, G, N>::write_buffer_canaries(T *data,
+                                                       std::size_t capacity) {
+    if constexpr (C::buffer_canaries) {
+        std::memcpy(reinterpret_cast<char *>(data) - sizeof(canary_value),
+                    &canary_value, sizeof(canary_value));
+        std::memcpy(reinterpret_cast<char *>(data + capacity), &canary_value,
+                    sizeof(canary_value));
+    }
+}
+
+template <class T, class A, class C, class L, class H, class G, std::size_t N>
+bool Stack<T, A, C, L, H, G, N>::resize_buffer(std::size_t capacity) {
+    if constexpr (detail::has_resize<A, T>::value) {
+        if (_data == nullptr || _size > capacity || is_inline(_data) ||
+            capacity <= N)
+            return false;
+        if (!_allocator.resize(_data - canary_slots,
+                               _capacity + 2 * canary_slots,
+                               capacity + 2 * canary_slots))
+            return false;
+        write_buffer_canaries(_data, capacity);
+        return true;
+    }
+    return false;
+}
+
+template <class T, class A, class C, class L, class H, class G, std::size_t N>
+T *Stack<T, A, C, L, H, G, N>::relocate_buffer(std::size_t capacity) {
+    if constexpr (detail::has_reallocate<A, T>::value) {
+        if (_data != nullptr && _size <= capacity && !is_inline(_data) &&
+            capacity > N) {
+            auto buffer = _allocator.reallocate(_data - canary_slots,
+                                                _capacity + 2 * canary_slots,
+                                                capacity + 2 * canary_slots);
+            auto data = buffer + canary_slots;
+            write_buffer_canaries(data, capacity);
+            return data;
+        }
+    }
+
+    auto data = allocate_buffer(capacity);
+    if (_data != nullptr) {
+        auto size = std::min(capacity, _size);
+        std::memcpy(static_cast<void *>(data), _data, size * sizeof(T));
+        std::destroy(_data + size, _data + _size);
+        deallocate_buffer(_data, _capacity);
+    }
+    return data;
+}
+
+template <class T, class A, class C, class L, class H, class G, std::size_t N>
+bool Stack<T, A, C, L, H, G, N>::buffer_canaries_valid() const {
+    if (_data == nullptr)
+        return true;
+    unsigned long long before, after;
+    std::memcpy(&before, reinterpret_cast<const char *>(_data) - sizeof(before),
+                sizeof(before));
+    std::memcpy(&after, _data + _capacity, sizeof(after));
+    return before == canary_value && after == canary_value;
+}
+
+template <class T, class A, class C, class L, class H, class G, std::size_t N>
+inline void Stack<T, A, C, L, H, G, N>::validate() const {
     if (!valid()) {
-        std::cerr << *this;
+        log(logging::Op::invalid_state);
         throw StackInvalidState{};
     }
 }
 
-template <class T, class A>
-HashType Stack<T, A>::compute_hash() const {
-    // zero old hash before computation
-    auto old_hash = _hash;
-    _hash = 0;
-    auto result = hash(*this);
-    _hash = old_hash;
+template <class T, class A, class C, class L, class H, class G, std::size_t N>
+inline void Stack<T, A, C, L, H, G, N>::validate_read() const {
+    if (!read_valid()) {
+        log(logging::Op::invalid_state);
+        throw StackInvalidState{};
+    }
+}
+
+template <class T, class A, class C, class L, class H, class G, std::size_t N>
+inline void Stack<T, A, C, L, H, G, N>::validate_mutation() {
+    if (!mutation_valid()) {
+        log(logging::Op::invalid_state);
+        throw StackInvalidState{};
+    }
+}
+
+template <class T, class A, class C, class L, class H, class G, std::size_t N>
+inline void Stack<T, A, C, L, H, G, N>::revalidate() {
+    if constexpr (C::on_exit)
+        validate_mutation();
+}
+
+template <class T, class A, class C, class L, class H, class G, std::size_t N>
+inline void Stack<T, A, C, L, H, G, N>::update_hash() {
+    if constexpr (C::hash && C::lazy_hash)
+        _pending = _pending + 1;
+    else if constexpr (C::hash)
+        _hash = compute_hash();
+}
+
+template <class T, class A, class C, class L, class H, class G, std::size_t N>
+inline void Stack<T, A, C, L, H, G, N>::rehash() {
+    if constexpr (C::hash)
+        _hash = compute_hash();
+    if constexpr (C::lazy_hash)
+        _pending = 0;
+}
+
+template <class T, class A, class C, class L, class H, class G, std::size_t N>
+inline void Stack<T, A, C, L, H, G, N>::set_size(std::size_t size) {
+    if constexpr (C::hash && C::lazy_hash)
+        _hash = static_cast<HashType>(_hash - field_hash(0, _size) +
+                                      field_hash(0, size));
+    _size = size;
+}
+
+template <class T, class A, class C, class L, class H, class G, std::size_t N>
+inline void Stack<T, A, C, L, H, G, N>::add_payload(std::uint64_t delta) {
+    if constexpr (C::hash && C::lazy_hash)
+        _hash = static_cast<HashType>(_hash - field_hash(1, _payload) +
+                                      field_hash(1, _payload + delta));
+    _payload += delta;
+}
+
+template <class T, class A, class C, class L, class H, class G, std::size_t N>
+inline typename Stack<T, A, C, L, H, G, N>::HashType
+Stack<T, A, C, L, H, G, N>::field_hash(std::uint64_t field,
+                                       std::uint64_t value) {
+    using hashers::Word64;
+    return static_cast<HashType>(
+        Word64::finalize(Word64::mix(Word64::seed + field, value)));
+}
+
+template <class T, class A, class C, class L, class H, class G, std::size_t N>
+inline typename Stack<T, A, C, L, H, G, N>::HashType
+Stack<T, A, C, L, H, G, N>::compute_hash() const {
+    return compute_hash(_data, _size, _payload,
+                        [](void *destination, const void *source,
+                           std::size_t size) {
+                            std::memcpy(destination, source, size);
+                        });
+}
+
+template <class T, class A, class C, class L, class H, class G, std::size_t N>
+template <class Load>
+typename Stack<T, A, C, L, H, G, N>::HashType
+Stack<T, A, C, L, H, G, N>::compute_hash(const T *data, std::size_t size,
+                                         decltype(_payload) payload,
+                                         Load load) const {
+    // the object is hashed except the stored hash, state changed by readers
+    // and (for inline elements) the top element and free slots. Fields of
+    // lazy hash changed by push and pop are added to it separately, so it
+    // can be updated in O(1).
+    using Range = std::pair<const unsigned char *, const unsigned char *>;
+    auto range = [](const auto &member) {
+        auto begin = reinterpret_cast<const unsigned char *>(&member);
+        return Range{begin, begin + sizeof(member)};
+    };
+    Range skipped[7];
+    std::size_t count = 0;
+    skipped[count++] = range(_hash);
+    if constexpr (C::lazy_hash) {
+        skipped[count++] = range(_size);
+        if constexpr (C::payload)
+            skipped[count++] = range(_payload);
+    }
+    if constexpr (N != 0) {
+        if (is_inline(data) && size <= N) {
+            auto sealed = reinterpret_cast<const unsigned char *>(
+                data + (size == 0 ? 0 : size - 1));
+            skipped[count++] = {sealed,
+                                _inline.bytes + sizeof(_inline.bytes)};
+        }
+    }
+    if constexpr (C::lazy_hash)
+        skipped[count++] = range(_pending);
+    if constexpr (C::sampled)
+        skipped[count++] = range(_sampler);
+    if constexpr (C::scrubbed)
+        skipped[count++] = range(_scrub);
+
+    // hashed parts are joined, so the hasher sees one block of data (and
+    // keeps its guarantees, e.g. CRC32C detects every short burst error)
+    unsigned char bytes[sizeof(Stack)];
+    std::size_t length = 0;
+    auto [begin, end] = range(*this);
+    for (std::size_t i = 0; i <= count; ++i) {
+        auto last = i != count ? skipped[i].first : end;
+        auto part = static_cast<std::size_t>(last - begin);
+        load(bytes + length, begin, part);
+        length += part;
+        if (i != count)
+            begin = skipped[i].second;
+    }
+    auto result = H::hash(bytes, length);
+    if constexpr (C::lazy_hash) {
+        result = static_cast<HashType>(result + field_hash(0, size));
+        if constexpr (C::payload)
+            result = static_cast<HashType>(result + field_hash(1, payload));
+    }
+    return result;
+}
+
+template <class T, class A, class C, class L, class H, class G, std::size_t N>
+std::uint64_t
+Stack<T, A, C, L, H, G, N>::element_hash(std::size_t index) const {
+    return element_hash(_data + index, index);
+}
+
+template <class T, class A, class C, class L, class H, class G, std::size_t N>
+std::uint64_t Stack<T, A, C, L, H, G, N>::element_hash(const void *element,
+                                                       std::size_t index) {
+    auto result = static_cast<std::uint64_t>(H::hash(element, sizeof(T)));
+    return hashers::Word64::finalize(hashers::Word64::mix(result, index));
+}
+
+template <class T, class A, class C, class L, class H, class G, std::size_t N>
+std::uint64_t Stack<T, A, C, L, H, G, N>::compute_payload() const {
+    std::uint64_t result = 0;
+    for (std::size_t i = 0; i + 1 < _size; ++i)
+        result += element_hash(i);
     return result;
 }
 
-template <class T, class A>
-std::ostream &operator<<(std::ostream &out, const Stack<T, A> &stack) {
+template <class T, class A, class C, class L, class H, class G, std::size_t N>
+void Stack<T, A, C, L, H, G, N>::seal_element(std::size_t index) {
+    auto hash = element_hash(index);
+    add_payload(hash);
+    if constexpr (C::block_size != 0)
+        _blocks[index / C::block_size] += hash;
+}
+
+template <class T, class A, class C, class L, class H, class G, std::size_t N>
+void Stack<T, A, C, L, H, G, N>::unseal_element(std::size_t index) {
+    auto hash = element_hash(index);
+    add_payload(-hash);
+    if constexpr (C::block_size != 0)
+        _blocks[index / C::block_size] -= hash;
+}
+
+template <class T, class A, class C, class L, class H, class G, std::size_t N>
+void Stack<T, A, C, L, H, G, N>::rebuild_payload() {
+    if constexpr (C::payload) {
+        _payload = 0;
+        if constexpr (C::block_size != 0)
+            std::fill_n(_blocks, block_count(_capacity), 0);
+        for (std::size_t i = 0; i + 1 < _size; ++i)
+            seal_element(i);
+    }
+}
+
+template <class T, class A, class C, class L, class H, class G, std::size_t N>
+bool Stack<T, A, C, L, H, G, N>::payload_valid(bool parallel) const {
+    if constexpr (C::block_size != 0) {
+        if (_size > _capacity)
+            return true;
+        std::uint64_t total = 0;
+        for (std::size_t i = 0; i < block_count(_capacity); ++i)
+            total += _blocks[i];
+        if (total != _payload)
+            return false;
+
+        auto count = block_count(_size == 0 ? 0 : _size - 1);
+        std::size_t threads = 0;
+        if (parallel)
+            threads = std::min<std::size_t>(
+                std::thread::hardware_concurrency(), count / blocks_per_thread);
+        if (threads <= 1)
+            return blocks_valid(0, count);
+
+        std::atomic<bool> result{true};
+        std::vector<std::thread> workers;
+        try {
+            workers.reserve(threads);
+            for (std::size_t i = 0; i < threads; ++i) {
+                workers.emplace_back([this, &result, i, threads, count] {
+                    if (!blocks_valid(count * i / threads,
+                                      count * (i + 1) / threads))
+                        result = false;
+                });
+            }
+        } catch (...) {
+            // a thread can't be started: started ones are joined and all
+            // blocks are checked by this thread
+            for (auto &worker : workers)
+                worker.join();
+            return blocks_valid(0, count);
+        }
+        for (auto &worker : workers)
+            worker.join();
+        return result;
+    } else if constexpr (C::payload) {
+        return _size > _capacity || _payload == compute_payload();
+    }
+    return true;
+}
+
+template <class T, class A, class C, class L, class H, class G, std::size_t N>
+std::size_t Stack<T, A, C, L, H, G, N>::block_count(std::size_t capacity) {
+    if constexpr (C::block_size != 0)
+        return (capacity + C::block_size - 1) / C::block_size;
+    return 0;
+}
+
+template <class T, class A, class C, class L, class H, class G, std::size_t N>
+std::uint64_t *
+Stack<T, A, C, L, H, G, N>::allocate_blocks(std::size_t capacity) {
+    if constexpr (C::block_size != 0) {
+        auto count = block_count(capacity);
+        if (count == 0)
+            return nullptr;
+        auto allocator = get_block_allocator();
+        auto blocks = block_traits::allocate(allocator, count);
+        auto kept = _blocks == nullptr
+                        ? 0
+                        : std::min(block_count(_capacity), count);
+        if (kept != 0)
+            std::copy_n(_blocks, kept, blocks);
+        std::fill_n(blocks + kept, count - kept, 0);
+        return blocks;
+    }
+    return nullptr;
+}
+
+template <class T, class A, class C, class L, class H, class G, std::size_t N>
+typename Stack<T, A, C, L, H, G, N>::block_allocator
+Stack<T, A, C, L, H, G, N>::get_block_allocator() const {
+    if constexpr (detail::has_resize<A, T>::value)
+        return {};
+    else
+        return block_allocator{_allocator};
+}
+
+template <class T, class A, class C, class L, class H, class G, std::size_t N>
+void Stack<T, A, C, L, H, G, N>::deallocate_blocks(std::uint64_t *blocks,
+                                                   std::size_t capacity) {
+    if constexpr (C::block_size != 0) {
+        if (blocks != nullptr) {
+            auto allocator = get_block_allocator();
+            block_traits::deallocate(allocator, blocks,
+                                     block_count(capacity));
+        }
+    }
+}
+
+template <class T, class A, class C, class L, class H, class G, std::size_t N>
+bool Stack<T, A, C, L, H, G, N>::block_valid(std::size_t block,
+                                             std::size_t sealed) const {
+    if constexpr (C::block_size != 0) {
+        std::uint64_t sum = 0;
+        auto end = std::min(sealed, (block + 1) * C::block_size);
+        for (auto i = block * C::block_size; i < end; ++i)
+            sum += element_hash(i);
+        return sum == _blocks[block];
+    }
+    return true;
+}
+
+template <class T, class A, class C, class L, class H, class G, std::size_t N>
+bool Stack<T, A, C, L, H, G, N>::blocks_valid(std::size_t first,
+                                              std::size_t last) const {
+    auto sealed = _size == 0 ? 0 : _size - 1;
+    for (auto block = first; block < last; ++block)
+        if (!block_valid(block, sealed))
+            return false;
+    return true;
+}
+
+template <class T, class A, class C, class L, class H, class G, std::size_t N>
+bool Stack<T, A, C, L, H, G, N>::last_block_valid() const {
+    if constexpr (C::block_size != 0) {
+        if (_size < 2)
+            return true;
+        auto block = (_size - 2) / C::block_size;
+        return blocks_valid(block, block + 1);
+    }
+    return true;
+}
+
+template <class T, class A, class C, class L, class H, class G, std::size_t N>
+void Stack<T, A, C, L, H, G, N>::validate_last_block() const {
+    if (!last_block_valid()) {
+        log(logging::Op::invalid_state);
+        throw StackInvalidState{};
+    }
+}
+
+template <class T, class A, class C, class L, class H, class G, std::size_t N>
+void Stack<T, A, C, L, H, G, N>::register_stack() {
+    if constexpr (C::scrubbed)
+        scrub::Scrubber::instance().add(this, &scrub_check);
+}
+
+template <class T, class A, class C, class L, class H, class G, std::size_t N>
+void Stack<T, A, C, L, H, G, N>::unregister_stack() const {
+    if constexpr (C::scrubbed)
+        scrub::Scrubber::instance().remove(this);
+}
+
+template <class T, class A, class C, class L, class H, class G, std::size_t N>
+inline void Stack<T, A, C, L, H, G, N>::wait_for_scrubber() const {
+    if constexpr (C::scrubbed)
+        _scrub.wait_for_readers();
+}
+
+template <class T, class A, class C, class L, class H, class G, std::size_t N>
+scrub::Result Stack<T, A, C, L, H, G, N>::scrub_check(const void *stack,
+                                                      bool deep) {
+    auto &self = *static_cast<const Stack *>(stack);
+    // the snapshot is consistent if the version hasn't changed, the buffer
+    // isn't freed until the read ends
+    return self._scrub.read(
+        [&] { return self.snapshot_valid(self.snapshot(), deep); });
+}
+
+template <class T, class A, class C, class L, class H, class G, std::size_t N>
+typename Stack<T, A, C, L, H, G, N>::Snapshot
+Stack<T, A, C, L, H, G, N>::snapshot() const {
+    auto load = [](auto &value, const auto &field) {
+        // absent fields (detail::Nothing) may share address with others
+        if constexpr (!std::is_empty_v<std::decay_t<decltype(field)>>)
+            scrub::load_relaxed(&value, &field, sizeof(field));
+    };
+    Snapshot result{};
+    load(result.start_canary, start_canary);
+    load(result.data, _data);
+    load(result.capacity, _capacity);
+    load(result.hash, _hash);
+    load(result.size, _size);
+    load(result.payload, _payload);
+    load(result.blocks, _blocks);
+    load(result.end_canary, end_canary);
+    return result;
+}
+
+template <class T, class A, class C, class L, class H, class G, std::size_t N>
+bool Stack<T, A, C, L, H, G, N>::snapshot_valid(const Snapshot &snapshot,
+                                                bool deep) const {
+    auto &[start, data, capacity, hash, size, payload, blocks, end] = snapshot;
+    if constexpr (C::canaries)
+        if (start != canary_value || end != canary_value)
+            return false;
+    if constexpr (C::hash)
+        if (hash != compute_hash(data, size, payload, scrub::load_relaxed))
+            return false;
+    if constexpr (C::invariants)
+        if (size > capacity || (capacity == 0) != (data == nullptr))
+            return false;
+    if (size > capacity || data == nullptr)
+        return true; // the buffer can't be read
+    if constexpr (C::buffer_canaries) {
+        unsigned long long before, after;
+        scrub::load_relaxed(&before,
+                            reinterpret_cast<const char *>(data) -
+                                sizeof(before),
+                            sizeof(before));
+        scrub::load_relaxed(&after, data + capacity, sizeof(after));
+        if (before != canary_value || after != canary_value)
+            return false;
+    }
+    if constexpr (C::payload) {
+        if (!C::deep && !deep)
+            return true;
+        // checksums of the elements are summed by blocks (one block if the
+        // elements aren't split into blocks)
+        auto block_size = C::block_size != 0 ? C::block_size : capacity;
+        auto sealed = size == 0 ? 0 : size - 1;
+        std::uint64_t total = 0;
+        for (std::size_t block = 0; block * block_size < capacity; ++block) {
+            std::uint64_t sum = 0;
+            auto last = std::min(sealed, (block + 1) * block_size);
+            for (auto i = block * block_size; i < last; ++i) {
+                alignas(T) unsigned char element[sizeof(T)];
+                scrub::load_relaxed(element, data + i, sizeof(T));
+                sum += element_hash(element, i);
+            }
+            if constexpr (C::block_size != 0) {
+                std::uint64_t expected;
+                scrub::load_relaxed(&expected, blocks + block,
+                                    sizeof(expected));
+                if (sum != expected)
+                    return false;
+            }
+            total += sum;
+        }
+        return total == payload;
+    }
+    return true;
+}
+
+template <class T, class A, class C, class L, class H, class G, std::size_t N>
+inline void Stack<T, A, C, L, H, G, N>::log(logging::Op op) const {
+    if constexpr (L::enabled)
+        L::log({op, this, _size, _capacity, _hash});
+}
+
+/// \brief Stack which keeps first `N` elements inside the object.
+template <class T, std::size_t N, class Allocator = std::allocator<T>,
+          class CheckPolicy = checks::Full>
+using SmallStack = Stack<T, Allocator, CheckPolicy, logging::None,
+                         hashers::Word64, growth::Hysteresis, N>;
+
+template <class T, class A, class C, class L, class H, class G, std::size_t N>
+std::ostream &operator<<(std::ostream &out,
+                         const Stack<T, A, C, L, H, G, N> &stack) {
     out << "Stack capacity: " << stack._capacity << " size: " << stack._size
-        << " hash: " << static_cast<int>(stack._hash) << " {"
+        << " hash: " << static_cast<std::uint64_t>(stack._hash) << " {"
         << "\n";
     for (auto i = 0u; i < stack._capacity; ++i) {
         out << "  [" << i << "] = ";
         if (i < stack._size)
-            out << stack._data[i];
+            detail::print_element(out, stack._data[i]);
         else
             out << "GARBAGE";
         out << ",\n";
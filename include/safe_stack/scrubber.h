@@ -0,0 +1,267 @@
+#ifndef SAFE_STACK_SCRUBBER_H
+#define SAFE_STACK_SCRUBBER_H
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+/// \brief Background integrity checks of registered stacks.
+///
+/// Stacks with checks::WithScrubber policy register themselves in the
+/// process-wide ::Scrubber. Its thread periodically checks every stack
+/// (canaries, hash, invariants and, optionally, checksums of the elements)
+/// and reports corrupted ones to the handler.
+///
+/// The owner of a stack never waits for the scrubber on push and pop. Every
+/// change of the stack is a seqlock write section (::State::version is odd
+/// during it): the scrubber reads the stack's fields with relaxed atomic
+/// loads, checks them and discards the result if the version has changed.
+/// The owner waits only before it frees or shrinks a buffer which the
+/// scrubber may be reading.
+///
+/// Usage: `Stack<T, std::allocator<T>, checks::WithScrubber<checks::Full>>`,
+/// then `scrub::start(period)` and `scrub::stop()`.
+namespace safe_stack::scrub {
+
+/// \brief Result of a check of one stack.
+enum class Result : unsigned char {
+    ok,
+    busy, ///< the stack was changed during the check
+    corrupted,
+};
+
+/// \brief Copies `size` bytes at `source`, which the owner of a stack may
+/// change meanwhile, with relaxed atomic loads. The copy may be inconsistent,
+/// it can be used only if the seqlock's version hasn't changed.
+inline void load_relaxed(void *destination, const void *source,
+                         std::size_t size) noexcept {
+    auto to = static_cast<unsigned char *>(destination);
+    auto from = static_cast<const unsigned char *>(source);
+#if defined(__GNUC__) || defined(__clang__)
+    // words of any type are loaded (like with memcpy)
+    using Word [[gnu::may_alias]] = std::uintptr_t;
+    for (; size != 0 && reinterpret_cast<std::uintptr_t>(from) % sizeof(Word);
+         --size)
+        *to++ = __atomic_load_n(from++, __ATOMIC_RELAXED);
+    for (; size >= sizeof(Word); size -= sizeof(Word)) {
+        auto word = __atomic_load_n(reinterpret_cast<const Word *>(from),
+                                    __ATOMIC_RELAXED);
+        std::memcpy(to, &word, sizeof(word));
+        to += sizeof(Word);
+        from += sizeof(Word);
+    }
+    for (; size != 0; --size)
+        *to++ = __atomic_load_n(from++, __ATOMIC_RELAXED);
+#else
+    for (; size != 0; --size)
+        *to++ = *static_cast<const volatile unsigned char *>(from++);
+#endif
+}
+
+/// \brief Seqlock state of a registered stack (shared with the scrubber).
+struct State {
+    /// Number of started and finished write sections (odd during a write).
+    std::atomic<std::uint64_t> version{0};
+    /// Set while the scrubber reads the stack's buffer.
+    std::atomic<bool> scrubbing{false};
+
+    /// \brief Starts a write section.
+    /// \return false if the section was already started (nested call).
+    bool begin_write() noexcept {
+        auto v = version.load(std::memory_order_relaxed);
+        if (v % 2 != 0)
+            return false;
+        version.store(v + 1, std::memory_order_relaxed);
+        // following writes can't be reordered before the odd version
+        std::atomic_thread_fence(std::memory_order_release);
+        return true;
+    }
+
+    /// \brief Finishes the write section.
+    void end_write() noexcept {
+        auto v = version.load(std::memory_order_relaxed);
+        version.store(v + 1, std::memory_order_release);
+    }
+
+    /// \brief Waits until the scrubber stops reading the buffer (must be
+    /// called inside a write section before the buffer is freed).
+    void wait_for_readers() const noexcept {
+        // pairs with the fence in read(): either the scrubber sees the odd
+        // version, or this thread sees its flag
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        while (scrubbing.load(std::memory_order_acquire))
+            std::this_thread::yield();
+    }
+
+    /// \brief Calls `check()` if no write section intersects it.
+    template <class Check>
+    Result read(Check check) noexcept {
+        scrubbing.store(true, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        auto result = Result::busy;
+        auto v = version.load(std::memory_order_acquire);
+        if (v % 2 == 0) {
+            bool valid = check();
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (version.load(std::memory_order_relaxed) == v)
+                result = valid ? Result::ok : Result::corrupted;
+        }
+        scrubbing.store(false, std::memory_order_release);
+        return result;
+    }
+};
+
+/// \brief Registry of stacks checked by the background thread (one per
+/// process).
+class Scrubber {
+public:
+    /// \brief Checks the registered stack (`deep` - check its elements too).
+    using Check = Result (*)(const void *stack, bool deep);
+
+    /// \brief Called with the address of every corrupted stack.
+    using Handler = std::function<void(const void *stack)>;
+
+    /// \brief Number of attempts to check a stack which is being changed.
+    static constexpr int attempts = 4;
+
+    /// \brief Returns the process-wide scrubber.
+    static Scrubber &instance() {
+        static Scrubber scrubber;
+        return scrubber;
+    }
+
+    /// \brief Registers the stack.
+    void add(const void *stack, Check check) {
+        std::lock_guard<std::mutex> lock{_mutex};
+        _stacks.emplace_back(stack, check);
+    }
+
+    /// \brief Unregisters the stack (does nothing if it isn't registered).
+    /// After the call the scrubber doesn't read the stack.
+    void remove(const void *stack) {
+        std::lock_guard<std::mutex> lock{_mutex};
+        auto it = std::find_if(_stacks.begin(), _stacks.end(), [&](auto &e) {
+            return e.first == stack;
+        });
+        if (it == _stacks.end())
+            return;
+        *it = _stacks.back();
+        _stacks.pop_back();
+    }
+
+    /// \brief Returns a number of registered stacks.
+    std::size_t size() const {
+        std::lock_guard<std::mutex> lock{_mutex};
+        return _stacks.size();
+    }
+
+    /// \brief Sets the handler of corrupted stacks. It is called by the
+    /// scrubber's thread without the registry locked, so it may create and
+    /// destroy scrubbed stacks. The reported stack may be destroyed by its
+    /// owner meanwhile, so the handler shouldn't dereference the address.
+    void set_handler(Handler handler) {
+        std::lock_guard<std::mutex> lock{_mutex};
+        _handler = std::move(handler);
+    }
+
+    /// \brief Checks every registered stack once on the calling thread.
+    /// Stacks which were changed during all attempts are skipped. The
+    /// registry is locked only while one stack is checked, so stacks
+    /// registered or removed during the pass may be skipped.
+    /// \return a number of corrupted stacks.
+    std::size_t scrub(bool deep = false) { return scrub_all(deep); }
+
+    /// \brief Starts checking the stacks every `period`.
+    /// \return false if the scrubber is already running.
+    bool start(std::chrono::milliseconds period, bool deep = false) {
+        std::lock_guard<std::mutex> lock{_mutex};
+        if (_thread.joinable())
+            return false;
+        _stopping = false;
+        _thread = std::thread{[this, period, deep] { run(period, deep); }};
+        return true;
+    }
+
+    /// \brief Stops the background thread.
+    void stop() {
+        std::unique_lock<std::mutex> lock{_mutex};
+        if (!_thread.joinable())
+            return;
+        _stopping = true;
+        lock.unlock();
+        _wakeup.notify_one();
+        _thread.join();
+    }
+
+    /// \brief Returns a number of finished background passes.
+    std::uint64_t passes() const {
+        return _passes.load(std::memory_order_relaxed);
+    }
+
+    ~Scrubber() { stop(); }
+
+private:
+    mutable std::mutex _mutex;
+    std::condition_variable _wakeup;
+    std::vector<std::pair<const void *, Check>> _stacks;
+    Handler _handler;
+    std::thread _thread;
+    bool _stopping{false};
+    std::atomic<std::uint64_t> _passes{0};
+
+    Scrubber() = default;
+
+    std::size_t scrub_all(bool deep) {
+        std::size_t corrupted = 0;
+        for (std::size_t index = 0;; ++index) {
+            // the lock keeps the stack alive during its check only
+            std::unique_lock<std::mutex> lock{_mutex};
+            if (index >= _stacks.size())
+                break;
+            auto [stack, check] = _stacks[index];
+            auto result = Result::busy;
+            for (int i = 0; i < attempts && result == Result::busy; ++i)
+                result = check(stack, deep);
+            if (result != Result::corrupted)
+                continue;
+            corrupted += 1;
+            auto handler = _handler;
+            lock.unlock();
+            if (handler)
+                handler(stack);
+        }
+        return corrupted;
+    }
+
+    void run(std::chrono::milliseconds period, bool deep) {
+        std::unique_lock<std::mutex> lock{_mutex};
+        while (!_stopping) {
+            lock.unlock();
+            scrub_all(deep);
+            _passes.fetch_add(1, std::memory_order_relaxed);
+            lock.lock();
+            if (!_stopping)
+                _wakeup.wait_for(lock, period);
+        }
+    }
+};
+
+/// \brief Starts the background checks (see Scrubber::start).
+inline bool start(std::chrono::milliseconds period, bool deep = false) {
+    return Scrubber::instance().start(period, deep);
+}
+
+/// \brief Stops the background checks (see Scrubber::stop).
+inline void stop() { Scrubber::instance().stop(); }
+
+} // namespace safe_stack::scrub
+
+#endif // SAFE_STACK_SCRUBBER_H
@@ -0,0 +1,608 @@
+#ifndef SAFE_STACK_SEGMENTED_STACK_H
+#define SAFE_STACK_SEGMENTED_STACK_H
+
+#include "safe_stack/safe_stack.h"
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <new> // for std::launder
+#include <type_traits>
+#include <utility> // for std::exchange
+#include <vector>
+
+namespace safe_stack {
+
+/// \brief Safe stack which stores elements in a chain of fixed-size chunks.
+///
+/// Unlike ::Stack it never reallocates: push allocates at most one chunk of
+/// `ChunkSize` elements and pop frees at most one, so both take constant time
+/// in the worst case, and elements never move (references returned by
+/// `top()` stay valid). One empty chunk is kept as a spare, so pushing and
+/// popping at a chunk boundary doesn't allocate every time.
+///
+/// Checks are selected by `CheckPolicy` like in ::Stack. Every chunk has its
+/// own canaries around the elements (checked if `CheckPolicy::canaries` or
+/// `CheckPolicy::buffer_canaries` is set) and, if `CheckPolicy::payload` is
+/// set, its own checksum of the elements. To keep checks in constant time,
+/// only canaries of the top and the spare chunks are checked with the
+/// stack's ones, other chunks are checked only by `deep_validate()`. `top()`
+/// checks the chunk with the last sealed element if
+/// `CheckPolicy::check_last_block` is set (chunks are the blocks, the value
+/// of `CheckPolicy::block_size` is ignored). Lazy hash, sampled checks and
+/// the scrubber are not supported.
+template <class T, class Allocator = std::allocator<T>,
+          class CheckPolicy = checks::Full, class Logger = logging::None,
+          class Hasher = hashers::Word64, std::size_t ChunkSize = 256>
+class SegmentedStack {
+    static_assert(ChunkSize != 0, "chunk must not be empty");
+    static_assert(!CheckPolicy::lazy_hash && !CheckPolicy::sampled &&
+                      !CheckPolicy::scrubbed,
+                  "segmented stack doesn't support lazy hash, sampled checks "
+                  "and the scrubber");
+
+    /// \brief Chunks' canaries are checked.
+    static constexpr bool chunk_canaries =
+        CheckPolicy::canaries || CheckPolicy::buffer_canaries;
+
+public:
+    /// \brief Type of the elements.
+    using value_type = T;
+
+    /// \brief Type of the checksum.
+    using HashType = typename Hasher::result_type;
+
+    /// \brief Number of elements in one chunk.
+    static constexpr std::size_t chunk_size = ChunkSize;
+
+    /// \brief Constructs an empty stack.
+    /// This function never fails.
+    SegmentedStack() noexcept;
+
+    /// \brief Constructs a copy of the stack.
+    /// \exception ::StackInvalidState Argument was invalid.
+    SegmentedStack(const SegmentedStack &o);
+
+    /// \brief Copies the stack to this stack.
+    /// \exception ::StackInvalidState Argument was invalid.
+    SegmentedStack &operator=(const SegmentedStack &o);
+
+    /// \brief Takes chunks of the stack, the stack becomes invalid.
+    /// \exception ::StackInvalidState Argument was invalid.
+    SegmentedStack(SegmentedStack &&o);
+
+    /// \brief Moves the stack to this stack, the stack becomes invalid.
+    /// \exception ::StackInvalidState Argument was invalid.
+    SegmentedStack &operator=(SegmentedStack &&o);
+
+    /// \brief Stack destructor
+    ~SegmentedStack();
+
+    /// \brief Pushes element to the end of the stack
+    /// \exception ::StackInvalidState The stack was invalid
+    void push(const T &elem);
+
+    /// \brief Pushes element to the end of the stack
+    /// \exception ::StackInvalidState The stack was invalid
+    void push(T &&elem);
+
+    template <class... Args>
+    void emplace(Args &&... args);
+
+    void pop();
+
+    T &top();
+
+    const T &top() const;
+
+    /// \brief Destroys all elements and frees all chunks.
+    void clear();
+
+    /// \brief Returns a number of elements in the stack.
+    std::size_t size() const;
+
+    /// \brief Checks if the stack is empty.
+    inline bool empty() const;
+
+    /// \brief Checks if the stack's internal representation is valid: its
+    /// canaries, canaries of the top and the spare chunks (not of the lower
+    /// ones, see deep_validate()), hash and invariants. Conditions disabled
+    /// by `CheckPolicy` are not checked.
+    inline bool valid() const;
+
+    /// \brief Validates the stack and all its chunks (canaries and checksums
+    /// of the elements). It takes O(n) time.
+    /// \exception ::StackInvalidState The stack or its elements were
+    /// corrupted.
+    void deep_validate() const;
+
+private:
+    using allocator_traits = std::allocator_traits<Allocator>;
+
+    static constexpr unsigned long long canary_value = 0xDEADBEEFBADF00Dul;
+
+    /// \brief Fixed-size chunk of elements, chunks are linked from the top
+    /// one to the bottom one.
+    struct Chunk {
+        Chunk *previous{nullptr};
+        /// Sum of checksums of the sealed elements in the chunk.
+        [[no_unique_address]] std::conditional_t<CheckPolicy::payload,
+                                                 std::uint64_t,
+                                                 detail::Nothing<0>>
+            payload{};
+        // canaries are right around the elements
+        decltype(canary_value) start_canary{canary_value};
+        alignas(T) unsigned char storage[ChunkSize * sizeof(T)];
+        decltype(canary_value) end_canary{canary_value};
+
+        T *data() { return std::launder(reinterpret_cast<T *>(storage)); }
+
+        const T *data() const {
+            return std::launder(reinterpret_cast<const T *>(storage));
+        }
+    };
+
+    using chunk_allocator =
+        typename allocator_traits::template rebind_alloc<Chunk>;
+    using chunk_traits = std::allocator_traits<chunk_allocator>;
+
+    decltype(canary_value) start_canary{canary_value};
+    Chunk *_top{nullptr};   // chunk with the top element
+    Chunk *_spare{nullptr}; // empty chunk for the next push
+    HashType _hash{0};
+    std::size_t _size{0};
+    Allocator _allocator;
+    decltype(canary_value) end_canary{canary_value};
+
+    /// \brief Returns a number of chunks for `size` elements.
+    static std::size_t chunk_count(std::size_t size);
+
+    /// \brief Returns the spare chunk or allocates a new one.
+    Chunk *take_chunk();
+
+    /// \brief Keeps an empty chunk as the spare one or frees it.
+    void release_chunk(Chunk *chunk);
+
+    void deallocate_chunk(Chunk *chunk);
+
+    /// \brief Pushes the element without any checks.
+    template <class... Args>
+    void emplace_internal(Args &&... args);
+
+    /// \brief Copies elements of `o` to this stack (which has no chunks).
+    void copy_elements(const SegmentedStack &o);
+
+    void clear_internal();
+
+    void validate() const;
+
+    /// \brief Validates the stack after a mutation (only if
+    /// `CheckPolicy::on_exit` is set).
+    void revalidate() const;
+
+    /// \brief Updates stored hash (only if `CheckPolicy::hash` is set).
+    void update_hash();
+
+    HashType compute_hash() const;
+
+    /// \brief Returns checksum of the element at `index` in the `chunk`.
+    std::uint64_t element_hash(const Chunk *chunk, std::size_t index) const;
+
+    /// \brief Adds the element to the checksum of its chunk.
+    void seal(Chunk *chunk, std::size_t index);
+
+    /// \brief Removes the element from the checksum of its chunk.
+    void unseal(Chunk *chunk, std::size_t index);
+
+    /// \brief Checks canaries of the chunk (if it exists).
+    static bool canaries_valid(const Chunk *chunk);
+
+    /// \brief Checks canaries and checksum of the chunk which starts with
+    /// element `first` and has `sealed` sealed elements.
+    bool chunk_valid(const Chunk *chunk, std::size_t first,
+                     std::size_t sealed) const;
+
+    /// \brief Checks all chunks.
+    bool chunks_valid() const;
+
+    /// \brief Checks the chunk containing last sealed element (if any).
+    /// \exception ::StackInvalidState The chunk was corrupted.
+    void validate_last_chunk() const;
+
+    /// \brief Reports the operation to the logger (if it is enabled).
+    void log(logging::Op op) const;
+};
+
+template <class T, class A, class C, class L, class H, std::size_t N>
+SegmentedStack<T, A, C, L, H, N>::SegmentedStack() noexcept {
+    update_hash();
+    log(logging::Op::construct);
+    revalidate();
+}
+
+template <class T, class A, class C, class L, class H, std::size_t N>
+SegmentedStack<T, A, C, L, H, N>::SegmentedStack(const SegmentedStack &o) {
+    o.validate();
+
+    _allocator = o._allocator;
+    copy_elements(o);
+    update_hash();
+    log(logging::Op::copy);
+
+    revalidate();
+}
+
+template <class T, class A, class C, class L, class H, std::size_t N>
+SegmentedStack<T, A, C, L, H, N> &
+SegmentedStack<T, A, C, L, H, N>::operator=(const SegmentedStack &o) {
+    if (this == &o)
+        return *this;
+
+    validate();
+    o.validate();
+    clear_internal();
+
+    _allocator = o._allocator;
+    copy_elements(o);
+    update_hash();
+    log(logging::Op::copy);
+
+    revalidate();
+    return *this;
+}
+
+template <class T, class A, class C, class L, class H, std::size_t N>
+SegmentedStack<T, A, C, L, H, N>::SegmentedStack(SegmentedStack &&o) {
+    o.validate();
+
+    _top = std::exchange(o._top, nullptr);
+    _spare = std::exchange(o._spare, nullptr);
+    _size = std::exchange(o._size, 1);
+    _allocator = std::move(o._allocator);
+    update_hash();
+    log(logging::Op::move);
+
+    revalidate();
+}
+
+template <class T, class A, class C, class L, class H, std::size_t N>
+SegmentedStack<T, A, C, L, H, N> &
+SegmentedStack<T, A, C, L, H, N>::operator=(SegmentedStack &&o) {
+    if (this == &o)
+        return *this;
+
+    validate();
+    o.validate();
+    clear();
+
+    _top = std::exchange(o._top, nullptr);
+    _spare = std::exchange(o._spare, nullptr);
+    _size = std::exchange(o._size, 1);
+    _allocator = std::move(o._allocator);
+    update_hash();
+    log(logging::Op::move);
+
+    revalidate();
+    return *this;
+}
+
+template <class T, class A, class C, class L, class H, std::size_t N>
+SegmentedStack<T, A, C, L, H, N>::~SegmentedStack() {
+    if (valid()) {
+        clear_internal();
+        log(logging::Op::destroy);
+    } else {
+        log(logging::Op::invalid_state);
+    }
+}
+
+template <class T, class A, class C, class L, class H, std::size_t N>
+void SegmentedStack<T, A, C, L, H, N>::push(const T &elem) {
+    return emplace(elem);
+}
+
+template <class T, class A, class C, class L, class H, std::size_t N>
+void SegmentedStack<T, A, C, L, H, N>::push(T &&elem) {
+    return emplace(std::move(elem));
+}
+
+template <class T, class A, class C, class L, class H, std::size_t N>
+template <class... Args>
+void SegmentedStack<T, A, C, L, H, N>::emplace(Args &&... args) {
+    validate();
+
+    emplace_internal(std::forward<Args>(args)...);
+    update_hash();
+    log(logging::Op::push);
+    revalidate();
+}
+
+template <class T, class A, class C, class L, class H, std::size_t N>
+void SegmentedStack<T, A, C, L, H, N>::pop() {
+    validate();
+    if (_size == 0)
+        throw StackUnderflow{};
+
+    _size = _size - 1;
+    allocator_traits::destroy(_allocator, _top->data() + _size % N);
+    if (_size % N == 0) // top chunk became empty
+        release_chunk(std::exchange(_top, _top->previous));
+    if constexpr (C::payload)
+        if (_size != 0) // new top element can be changed
+            unseal(_top, _size - 1);
+    update_hash();
+    log(logging::Op::pop);
+    revalidate();
+}
+
+template <class T, class A, class C, class L, class H, std::size_t N>
+T &SegmentedStack<T, A, C, L, H, N>::top() {
+    validate();
+    if (_size == 0)
+        throw StackUnderflow{};
+    validate_last_chunk();
+
+    return _top->data()[(_size - 1) % N];
+}
+
+template <class T, class A, class C, class L, class H, std::size_t N>
+const T &SegmentedStack<T, A, C, L, H, N>::top() const {
+    validate();
+    if (_size == 0)
+        throw StackUnderflow{};
+    validate_last_chunk();
+
+    return _top->data()[(_size - 1) % N];
+}
+
+template <class T, class A, class C, class L, class H, std::size_t N>
+void SegmentedStack<T, A, C, L, H, N>::clear() {
+    validate();
+    clear_internal();
+    log(logging::Op::clear);
+    revalidate();
+}
+
+template <class T, class A, class C, class L, class H, std::size_t N>
+std::size_t SegmentedStack<T, A, C, L, H, N>::size() const {
+    validate();
+    return _size;
+}
+
+template <class T, class A, class C, class L, class H, std::size_t N>
+inline bool SegmentedStack<T, A, C, L, H, N>::empty() const {
+    return size() == 0;
+}
+
+template <class T, class A, class C, class L, class H, std::size_t N>
+inline bool SegmentedStack<T, A, C, L, H, N>::valid() const {
+    if constexpr (C::canaries)
+        if (start_canary != canary_value || end_canary != canary_value)
+            return false;
+    if constexpr (C::hash)
+        if (_hash != compute_hash())
+            return false;
+    if constexpr (C::invariants)
+        if ((_size == 0) != (_top == nullptr))
+            return false;
+    if constexpr (chunk_canaries)
+        if (!canaries_valid(_top) || !canaries_valid(_spare))
+            return false;
+    if constexpr (C::deep)
+        return chunks_valid();
+    return true;
+}
+
+template <class T, class A, class C, class L, class H, std::size_t N>
+void SegmentedStack<T, A, C, L, H, N>::deep_validate() const {
+    validate();
+    if (!chunks_valid()) {
+        log(logging::Op::invalid_state);
+        throw StackInvalidState{};
+    }
+}
+
+template <class T, class A, class C, class L, class H, std::size_t N>
+std::size_t SegmentedStack<T, A, C, L, H, N>::chunk_count(std::size_t size) {
+    return (size + N - 1) / N;
+}
+
+template <class T, class A, class C, class L, class H, std::size_t N>
+typename SegmentedStack<T, A, C, L, H, N>::Chunk *
+SegmentedStack<T, A, C, L, H, N>::take_chunk() {
+    if (_spare != nullptr)
+        return std::exchange(_spare, nullptr);
+    chunk_allocator allocator{_allocator};
+    auto chunk = chunk_traits::allocate(allocator, 1);
+    return ::new (static_cast<void *>(chunk)) Chunk;
+}
+
+template <class T, class A, class C, class L, class H, std::size_t N>
+void SegmentedStack<T, A, C, L, H, N>::release_chunk(Chunk *chunk) {
+    if (_spare != nullptr)
+        return deallocate_chunk(chunk);
+    chunk->previous = nullptr;
+    if constexpr (C::payload)
+        chunk->payload = 0;
+    _spare = chunk;
+}
+
+template <class T, class A, class C, class L, class H, std::size_t N>
+void SegmentedStack<T, A, C, L, H, N>::deallocate_chunk(Chunk *chunk) {
+    chunk_allocator allocator{_allocator};
+    chunk->~Chunk();
+    chunk_traits::deallocate(allocator, chunk, 1);
+}
+
+template <class T, class A, class C, class L, class H, std::size_t N>
+template <class... Args>
+void SegmentedStack<T, A, C, L, H, N>::emplace_internal(Args &&... args) {
+    auto offset = _size % N;
+    auto chunk = offset == 0 ? take_chunk() : _top;
+    try {
+        allocator_traits::construct(_allocator, chunk->data() + offset,
+                                    std::forward<Args>(args)...);
+    } catch (...) {
+        if (offset == 0) {
+            release_chunk(chunk);
+            update_hash();
+        }
+        throw;
+    }
+    if constexpr (C::payload)
+        if (_size != 0) // old top element can't be changed anymore
+            seal(_top, _size - 1);
+    if (offset == 0) {
+        chunk->previous = _top;
+        _top = chunk;
+    }
+    _size = _size + 1;
+}
+
+template <class T, class A, class C, class L, class H, std::size_t N>
+void SegmentedStack<T, A, C, L, H, N>::copy_elements(
+    const SegmentedStack &o) {
+    std::vector<const Chunk *> chunks; // from the top one to the bottom one
+    for (auto chunk = o._top; chunk != nullptr; chunk = chunk->previous)
+        chunks.push_back(chunk);
+    try {
+        for (std::size_t i = 0; i < o._size; ++i)
+            emplace_internal(chunks[chunks.size() - 1 - i / N]->data()[i % N]);
+    } catch (...) {
+        clear_internal();
+        throw;
+    }
+}
+
+template <class T, class A, class C, class L, class H, std::size_t N>
+void SegmentedStack<T, A, C, L, H, N>::clear_internal() {
+    while (_top != nullptr) {
+        auto count = (_size - 1) % N + 1;
+        std::destroy_n(_top->data(), count);
+        _size -= count;
+        deallocate_chunk(std::exchange(_top, _top->previous));
+    }
+    if (_spare != nullptr)
+        deallocate_chunk(std::exchange(_spare, nullptr));
+    _size = 0;
+    update_hash();
+    revalidate();
+}
+
+template <class T, class A, class C, class L, class H, std::size_t N>
+inline void SegmentedStack<T, A, C, L, H, N>::validate() const {
+    if (!valid()) {
+        log(logging::Op::invalid_state);
+        throw StackInvalidState{};
+    }
+}
+
+template <class T, class A, class C, class L, class H, std::size_t N>
+inline void SegmentedStack<T, A, C, L, H, N>::revalidate() const {
+    if constexpr (C::on_exit)
+        validate();
+}
+
+template <class T, class A, class C, class L, class H, std::size_t N>
+inline void SegmentedStack<T, A, C, L, H, N>::update_hash() {
+    if constexpr (C::hash)
+        _hash = compute_hash();
+}
+
+template <class T, class A, class C, class L, class H, std::size_t N>
+typename SegmentedStack<T, A, C, L, H, N>::HashType
+SegmentedStack<T, A, C, L, H, N>::compute_hash() const {
+    // the object is hashed except the stored hash, parts around it are
+    // joined, so the hasher sees one block of data (like in ::Stack)
+    auto object = reinterpret_cast<const unsigned char *>(this);
+    auto hash = reinterpret_cast<const unsigned char *>(&_hash);
+    auto before = static_cast<std::size_t>(hash - object);
+    auto after = sizeof(SegmentedStack) - before - sizeof(_hash);
+    unsigned char bytes[sizeof(SegmentedStack)];
+    std::memcpy(bytes, object, before);
+    std::memcpy(bytes + before, hash + sizeof(_hash), after);
+    return H::hash(bytes, before + after);
+}
+
+template <class T, class A, class C, class L, class H, std::size_t N>
+std::uint64_t
+SegmentedStack<T, A, C, L, H, N>::element_hash(const Chunk *chunk,
+                                               std::size_t index) const {
+    auto result = static_cast<std::uint64_t>(
+        H::hash(chunk->data() + index % N, sizeof(T)));
+    return hashers::Word64::finalize(hashers::Word64::mix(result, index));
+}
+
+template <class T, class A, class C, class L, class H, std::size_t N>
+void SegmentedStack<T, A, C, L, H, N>::seal(Chunk *chunk, std::size_t index) {
+    chunk->payload += element_hash(chunk, index);
+}
+
+template <class T, class A, class C, class L, class H, std::size_t N>
+void SegmentedStack<T, A, C, L, H, N>::unseal(Chunk *chunk,
+                                              std::size_t index) {
+    chunk->payload -= element_hash(chunk, index);
+}
+
+template <class T, class A, class C, class L, class H, std::size_t N>
+bool SegmentedStack<T, A, C, L, H, N>::canaries_valid(const Chunk *chunk) {
+    return chunk == nullptr || (chunk->start_canary == canary_value &&
+                                chunk->end_canary == canary_value);
+}
+
+template <class T, class A, class C, class L, class H, std::size_t N>
+bool SegmentedStack<T, A, C, L, H, N>::chunk_valid(const Chunk *chunk,
+                                                   std::size_t first,
+                                                   std::size_t sealed) const {
+    if constexpr (chunk_canaries)
+        if (!canaries_valid(chunk))
+            return false;
+    if constexpr (C::payload) {
+        std::uint64_t sum = 0;
+        for (auto i = first; i < first + sealed; ++i)
+            sum += element_hash(chunk, i);
+        return sum == chunk->payload;
+    }
+    return true;
+}
+
+template <class T, class A, class C, class L, class H, std::size_t N>
+bool SegmentedStack<T, A, C, L, H, N>::chunks_valid() const {
+    auto chunk = _top;
+    for (auto i = chunk_count(_size); i != 0; --i) {
+        if (chunk == nullptr)
+            return false;
+        auto first = (i - 1) * N;
+        // only the top element is not sealed
+        auto sealed = chunk == _top ? _size - 1 - first : N;
+        if (!chunk_valid(chunk, first, sealed))
+            return false;
+        chunk = chunk->previous;
+    }
+    return chunk == nullptr;
+}
+
+template <class T, class A, class C, class L, class H, std::size_t N>
+void SegmentedStack<T, A, C, L, H, N>::validate_last_chunk() const {
+    if constexpr (C::check_last_block) {
+        if (_size < 2)
+            return;
+        auto last = _size - 2; // last sealed element
+        auto chunk = (_size - 1) % N == 0 ? _top->previous : _top;
+        auto first = last / N * N;
+        if (chunk == nullptr || !chunk_valid(chunk, first, last - first + 1)) {
+            log(logging::Op::invalid_state);
+            throw StackInvalidState{};
+        }
+    }
+}
+
+template <class T, class A, class C, class L, class H, std::size_t N>
+inline void SegmentedStack<T, A, C, L, H, N>::log(logging::Op op) const {
+    if constexpr (L::enabled)
+        L::log({op, this, _size, chunk_count(_size) * N, _hash});
+}
+
+} // namespace safe_stack
+
+#endif // SAFE_STACK_SEGMENTED_STACK_H
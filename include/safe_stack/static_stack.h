@@ -0,0 +1,240 @@
+#ifndef SAFE_STACK_STATIC_STACK_H
+#define SAFE_STACK_STATIC_STACK_H
+
+#include "safe_stack/checks.h"
+#include "safe_stack/error.h"
+#include "safe_stack/hash.h"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <utility> // for std::move
+
+namespace safe_stack {
+
+/// \brief Safe stack of at most `Capacity` elements stored inside the object.
+///
+/// It never allocates memory and never throws: every operation reports errors
+/// with ::Status, so the stack can be used in signal handlers and real-time
+/// threads. Every operation is `constexpr`, so (for literal `T`) programs
+/// using the stack can be evaluated at compile time.
+///
+/// Like ::Stack, it has canaries around its fields and the hash of the fields
+/// (computed from their values, not bytes, to be available at compile time).
+/// Checks are selected by `CheckPolicy`. Checksum of the elements
+/// (`CheckPolicy::payload`) is supported for integral and enumeration types
+/// only. `CheckPolicy::block_size` and `CheckPolicy::buffer_canaries` are
+/// ignored (elements are already between the canaries).
+///
+/// Elements are default-constructed when the stack is created and reset to
+/// `T{}` when they are popped.
+template <class T, std::size_t Capacity, class CheckPolicy = checks::Full>
+class StaticStack {
+    static_assert(!CheckPolicy::payload || std::is_integral_v<T> ||
+                      std::is_enum_v<T>,
+                  "checksum of elements requires integral or enum elements");
+
+public:
+    /// \brief Type of the elements.
+    using value_type = T;
+
+    /// \brief Constructs an empty stack.
+    constexpr StaticStack() noexcept(
+        std::is_nothrow_default_constructible_v<T>) {
+        update_hash();
+    }
+
+    /// \brief Pushes element to the end of the stack.
+    /// \return Status::overflow if the stack is full, Status::invalid_state
+    /// if the stack was corrupted.
+    constexpr Status push(const T &elem) noexcept(
+        std::is_nothrow_copy_assignable_v<T>) {
+        if (!valid())
+            return Status::invalid_state;
+        if (_size == Capacity)
+            return Status::overflow;
+
+        _data[_size] = elem;
+        return pushed();
+    }
+
+    /// \brief Pushes element to the end of the stack.
+    constexpr Status push(T &&elem) noexcept(
+        std::is_nothrow_move_assignable_v<T>) {
+        if (!valid())
+            return Status::invalid_state;
+        if (_size == Capacity)
+            return Status::overflow;
+
+        _data[_size] = std::move(elem);
+        return pushed();
+    }
+
+    /// \brief Removes the top element.
+    /// \return Status::underflow if the stack is empty,
+    /// Status::invalid_state if the stack was corrupted.
+    constexpr Status pop() noexcept(std::is_nothrow_move_assignable_v<T>) {
+        if (!valid())
+            return Status::invalid_state;
+        if (_size == 0)
+            return Status::underflow;
+
+        _size = _size - 1;
+        _data[_size] = T{};
+        if constexpr (CheckPolicy::payload)
+            if (_size != 0) // new top element can be changed
+                _payload -= element_hash(_size - 1);
+        update_hash();
+        return revalidate();
+    }
+
+    /// \brief Returns a pointer to the top element.
+    /// \return nullptr if the stack is empty or was corrupted.
+    constexpr T *top() noexcept {
+        if (!valid() || _size == 0)
+            return nullptr;
+        return &_data[_size - 1];
+    }
+
+    /// \brief Returns a pointer to the top element.
+    /// \return nullptr if the stack is empty or was corrupted.
+    constexpr const T *top() const noexcept {
+        if (!valid() || _size == 0)
+            return nullptr;
+        return &_data[_size - 1];
+    }
+
+    /// \brief Removes all elements.
+    /// \return Status::invalid_state if the stack was corrupted.
+    constexpr Status clear() noexcept(std::is_nothrow_move_assignable_v<T>) {
+        if (!valid())
+            return Status::invalid_state;
+
+        for (std::size_t i = 0; i < _size; ++i)
+            _data[i] = T{};
+        _size = 0;
+        if constexpr (CheckPolicy::payload)
+            _payload = 0;
+        update_hash();
+        return revalidate();
+    }
+
+    /// \brief Returns a number of elements in the stack.
+    /// Unlike ::Stack::size(), it isn't checked: it has no way to report an
+    /// error (the stack never throws), so a corrupted size is reported by the
+    /// next push(), pop() or top(). Call valid() to check the stack first.
+    constexpr std::size_t size() const noexcept { return _size; }
+
+    /// \brief Checks if the stack is empty (without any checks, see size()).
+    constexpr bool empty() const noexcept { return _size == 0; }
+
+    /// \brief Returns the maximal number of elements.
+    static constexpr std::size_t capacity() noexcept { return Capacity; }
+
+    /// \brief Checks if the stack's internal representation is valid.
+    /// Stack is valid if all these conditions holds:
+    /// 1. All canaries are correct
+    /// 2. Hash is correct
+    /// 3. \f$size \le Capacity\f$
+    /// 4. Checksum of the elements is correct (only if `CheckPolicy::deep` is
+    /// set, it takes O(n) time)
+    /// Conditions disabled by `CheckPolicy` are not checked.
+    constexpr bool valid() const noexcept {
+        if constexpr (CheckPolicy::canaries)
+            if (start_canary != canary_value || end_canary != canary_value)
+                return false;
+        if constexpr (CheckPolicy::hash)
+            if (_hash != compute_hash())
+                return false;
+        if constexpr (CheckPolicy::invariants)
+            if (_size > Capacity)
+                return false;
+        if constexpr (CheckPolicy::deep)
+            return payload_valid();
+        return true;
+    }
+
+    /// \brief Validates the stack and, if `CheckPolicy::payload` is set,
+    /// checksum of its elements. It takes O(n) time.
+    /// \return Status::invalid_state if the stack or its elements were
+    /// corrupted.
+    constexpr Status deep_validate() const noexcept {
+        if (!valid() || !payload_valid())
+            return Status::invalid_state;
+        return Status::ok;
+    }
+
+private:
+    static constexpr unsigned long long canary_value = 0xDEADBEEFBADF00Dul;
+
+    decltype(canary_value) start_canary{canary_value};
+    std::array<T, Capacity> _data{};
+    std::size_t _size{0};
+    std::uint64_t _hash{0};
+    /// Sum of checksums of all elements except the top one. Exists only if
+    /// `CheckPolicy::payload` set.
+    [[no_unique_address]] std::conditional_t<CheckPolicy::payload,
+                                             std::uint64_t, detail::Nothing<0>>
+        _payload{};
+    decltype(canary_value) end_canary{canary_value};
+
+    /// \brief Finishes push of the element at `_size`.
+    constexpr Status pushed() noexcept {
+        if constexpr (CheckPolicy::payload)
+            if (_size != 0) // old top element can't be changed anymore
+                _payload += element_hash(_size - 1);
+        _size = _size + 1;
+        update_hash();
+        return revalidate();
+    }
+
+    /// \brief Validates the stack after a mutation (only if
+    /// `CheckPolicy::on_exit` is set).
+    constexpr Status revalidate() const noexcept {
+        if constexpr (CheckPolicy::on_exit)
+            if (!valid())
+                return Status::invalid_state;
+        return Status::ok;
+    }
+
+    /// \brief Updates stored hash (only if `CheckPolicy::hash` is set).
+    constexpr void update_hash() noexcept {
+        if constexpr (CheckPolicy::hash)
+            _hash = compute_hash();
+    }
+
+    constexpr std::uint64_t compute_hash() const noexcept {
+        using hashers::Word64;
+        auto state = Word64::mix(Word64::seed, start_canary);
+        state = Word64::mix(state, _size);
+        if constexpr (CheckPolicy::payload)
+            state = Word64::mix(state, _payload);
+        state = Word64::mix(state, end_canary);
+        return Word64::finalize(state);
+    }
+
+    /// \brief Returns checksum of the element at `index` (depends on the
+    /// element's value and its position).
+    constexpr std::uint64_t element_hash(std::size_t index) const noexcept {
+        using hashers::Word64;
+        auto value = static_cast<std::uint64_t>(_data[index]);
+        return Word64::finalize(Word64::mix(value, index));
+    }
+
+    /// \brief Checks if the checksum of the elements is correct.
+    constexpr bool payload_valid() const noexcept {
+        if constexpr (CheckPolicy::payload) {
+            if (_size > Capacity)
+                return true;
+            std::uint64_t sum = 0;
+            for (std::size_t i = 0; i + 1 < _size; ++i)
+                sum += element_hash(i);
+            return sum == _payload;
+        }
+        return true;
+    }
+};
+
+} // namespace safe_stack
+
+#endif // SAFE_STACK_STATIC_STACK_H
@@ -0,0 +1,302 @@
+#ifndef SAFE_STACK_TRACE_H
+#define SAFE_STACK_TRACE_H
+
+#include "safe_stack/logging.h"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/// \brief Binary event trace of stack operations.
+///
+/// Every thread writes events into its own lock-free single-producer
+/// single-consumer ring buffer (only the first event of a thread takes a lock
+/// to register its buffer, the lock is never held during I/O). Background
+/// thread drains all buffers into a binary file: ::TraceHeader followed by
+/// ::TraceRecord entries. When buffer is full new events are dropped and
+/// counted. Every buffer takes about 3 MiB (`buffer_size` records of 48
+/// bytes) and lives until its thread exits.
+///
+/// Usage: `Stack<T, std::allocator<T>, checks::Full, trace::Logger>`, then
+/// `trace::start("file")` and `trace::stop()`. Events are ignored while
+/// the tracer is stopped.
+namespace safe_stack::trace {
+
+/// \brief Trace file header.
+struct TraceHeader {
+    char magic[4]{'S', 'S', 'T', 'R'};
+    std::uint32_t version{1};
+};
+
+/// \brief One event in the trace file.
+struct TraceRecord {
+    std::uint64_t timestamp; ///< nanoseconds since tracer start
+    std::uint64_t stack;     ///< address of the stack
+    std::uint64_t size;
+    std::uint64_t capacity;
+    std::uint64_t hash;
+    std::uint32_t thread; ///< index of the thread in the order of first event
+    logging::Op op;
+    /// Explicit padding, so no uninitialized bytes are written to the file.
+    std::uint8_t reserved[3]{};
+};
+
+static_assert(sizeof(TraceRecord) == 48, "trace record has implicit padding");
+
+/// \brief Number of records in the buffer of one thread (3 MiB).
+constexpr std::size_t buffer_size = 1 << 16;
+
+/// \brief Single-producer single-consumer ring buffer.
+struct RingBuffer {
+    std::array<TraceRecord, buffer_size> records;
+    alignas(64) std::atomic<std::size_t> head{0}; // written by producer
+    alignas(64) std::atomic<std::size_t> tail{0}; // written by consumer
+    std::uint32_t thread{0};
+    /// Set when the producer thread exits (the buffer is removed after it is
+    /// drained).
+    std::atomic<bool> exited{false};
+    /// Set while the producer records an event (stop() waits for it).
+    std::atomic<bool> writing{false};
+
+    /// \brief Appends the record, returns false if the buffer is full.
+    bool push(const TraceRecord &record) {
+        auto h = head.load(std::memory_order_relaxed);
+        if (h - tail.load(std::memory_order_acquire) == buffer_size)
+            return false;
+        records[h % buffer_size] = record;
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+    /// \brief Writes all available records to the file.
+    void drain(std::FILE *file) {
+        auto t = tail.load(std::memory_order_relaxed);
+        auto h = head.load(std::memory_order_acquire);
+        while (t != h) {
+            // write contiguous part of the ring at once
+            auto begin = t % buffer_size;
+            auto count = std::min(h - t, buffer_size - begin);
+            std::fwrite(&records[begin], sizeof(TraceRecord), count, file);
+            t += count;
+        }
+        tail.store(t, std::memory_order_release);
+    }
+};
+
+/// \brief Tracer state (one per process).
+class Tracer {
+public:
+    /// \brief Returns the process-wide tracer.
+    static Tracer &instance() {
+        static Tracer tracer;
+        return tracer;
+    }
+
+    /// \brief Starts writing events to the file.
+    /// \return false if the file cannot be opened or tracer is already
+    /// running.
+    bool start(const std::string &path,
+               std::chrono::milliseconds period = std::chrono::milliseconds{
+                   1}) {
+        std::lock_guard<std::mutex> lock{_mutex};
+        if (_file != nullptr)
+            return false;
+        _file = std::fopen(path.c_str(), "wb");
+        if (_file == nullptr)
+            return false;
+        TraceHeader header;
+        std::fwrite(&header, sizeof(header), 1, _file);
+        _start = std::chrono::steady_clock::now();
+        _dropped.store(0, std::memory_order_relaxed);
+        _stopping = false;
+        _drainer = std::thread{[this, period] { run(period); }};
+        _running.store(true, std::memory_order_release);
+        return true;
+    }
+
+    /// \brief Stops tracing, writes remaining events and closes the file.
+    /// Events recorded concurrently are written too, so none of them is left
+    /// for the next session.
+    void stop() {
+        std::unique_lock<std::mutex> lock{_mutex};
+        if (_file == nullptr || _stopping)
+            return;
+        // pairs with the check in record(): either the writer sees the
+        // tracer stopped, or this thread sees its flag
+        _running.store(false, std::memory_order_seq_cst);
+        _stopping = true;
+        auto buffers = _buffers;
+        lock.unlock();
+        _wakeup.notify_one();
+        _drainer.join();
+        for (auto &buffer : buffers)
+            while (buffer->writing.load(std::memory_order_seq_cst))
+                std::this_thread::yield();
+        drain_all();
+        std::fclose(_file);
+        lock.lock();
+        _file = nullptr;
+        _stopping = false;
+    }
+
+    /// \brief Records the event of the current thread.
+    void record(const logging::Event &event) {
+        if (!_running.load(std::memory_order_acquire))
+            return;
+        auto &buffer = local_buffer();
+        buffer.writing.store(true, std::memory_order_seq_cst);
+        if (!_running.load(std::memory_order_seq_cst)) {
+            buffer.writing.store(false, std::memory_order_relaxed);
+            return;
+        }
+        auto now = std::chrono::steady_clock::now() - _start;
+        TraceRecord record{
+            static_cast<std::uint64_t>(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(now)
+                    .count()),
+            reinterpret_cast<std::uintptr_t>(event.stack),
+            event.size,
+            event.capacity,
+            event.hash,
+            buffer.thread,
+            event.op};
+        if (!buffer.push(record))
+            _dropped.fetch_add(1, std::memory_order_relaxed);
+        buffer.writing.store(false, std::memory_order_release);
+    }
+
+    /// \brief Returns a number of buffers of threads (including exited ones
+    /// which weren't drained yet).
+    std::size_t buffers() {
+        std::lock_guard<std::mutex> lock{_mutex};
+        return _buffers.size();
+    }
+
+    /// \brief Returns a number of events dropped because of full buffers.
+    std::uint64_t dropped() const {
+        return _dropped.load(std::memory_order_relaxed);
+    }
+
+    ~Tracer() { stop(); }
+
+private:
+    std::mutex _mutex;
+    std::condition_variable _wakeup;
+    std::vector<std::shared_ptr<RingBuffer>> _buffers;
+    std::uint32_t _threads{0}; // number of threads which recorded events
+    std::FILE *_file{nullptr};
+    std::thread _drainer;
+    bool _stopping{false}; // stop() was called and hasn't finished yet
+    std::atomic<bool> _running{false};
+    std::atomic<std::uint64_t> _dropped{0};
+    std::chrono::steady_clock::time_point _start;
+
+    Tracer() = default;
+
+    /// \brief Marks the buffer of the thread exited when the thread ends.
+    struct Owner {
+        std::shared_ptr<RingBuffer> buffer;
+
+        ~Owner() {
+            if (buffer)
+                buffer->exited.store(true, std::memory_order_release);
+        }
+    };
+
+    /// \brief Returns the buffer of the current thread, registers it on the
+    /// first call. Buffer outlives the thread until it is drained, so its
+    /// events are not lost.
+    RingBuffer &local_buffer() {
+        thread_local Owner owner;
+        if (!owner.buffer) {
+            owner.buffer = std::make_shared<RingBuffer>();
+            std::lock_guard<std::mutex> lock{_mutex};
+            owner.buffer->thread = _threads++;
+            _buffers.push_back(owner.buffer);
+        }
+        return *owner.buffer;
+    }
+
+    /// \brief Drains all buffers, removes buffers of exited threads. The
+    /// list of buffers is copied, so new threads aren't blocked by I/O.
+    void drain_all() {
+        std::unique_lock<std::mutex> lock{_mutex};
+        auto buffers = _buffers;
+        lock.unlock();
+        std::vector<const RingBuffer *> exited;
+        for (auto &buffer : buffers) {
+            // the thread's last events are visible if it has exited
+            if (buffer->exited.load(std::memory_order_acquire))
+                exited.push_back(buffer.get());
+            buffer->drain(_file);
+        }
+        if (exited.empty())
+            return;
+        lock.lock();
+        auto removed = [&](const std::shared_ptr<RingBuffer> &buffer) {
+            return std::find(exited.begin(), exited.end(), buffer.get()) !=
+                   exited.end();
+        };
+        _buffers.erase(
+            std::remove_if(_buffers.begin(), _buffers.end(), removed),
+            _buffers.end());
+    }
+
+    void run(std::chrono::milliseconds period) {
+        std::unique_lock<std::mutex> lock{_mutex};
+        while (!_stopping) {
+            lock.unlock();
+            drain_all();
+            std::fflush(_file);
+            lock.lock();
+            if (!_stopping)
+                _wakeup.wait_for(lock, period);
+        }
+    }
+};
+
+/// \brief Logging policy which writes events to the trace.
+struct Logger {
+    static constexpr bool enabled = true;
+
+    static void log(const logging::Event &event) {
+        Tracer::instance().record(event);
+    }
+};
+
+/// \brief Starts tracing to the file (see Tracer::start).
+inline bool start(const std::string &path) {
+    return Tracer::instance().start(path);
+}
+
+/// \brief Stops tracing (see Tracer::stop).
+inline void stop() { Tracer::instance().stop(); }
+
+/// \brief Reads the trace file written by the tracer.
+/// \return false if the file cannot be opened or has wrong header.
+inline bool read(const std::string &path, std::vector<TraceRecord> &records) {
+    auto file = std::fopen(path.c_str(), "rb");
+    if (file == nullptr)
+        return false;
+    TraceHeader expected, header;
+    bool ok = std::fread(&header, sizeof(header), 1, file) == 1 &&
+              std::equal(header.magic, header.magic + 4, expected.magic) &&
+              header.version == expected.version;
+    TraceRecord record;
+    while (ok && std::fread(&record, sizeof(record), 1, file) == 1)
+        records.push_back(record);
+    std::fclose(file);
+    return ok;
+}
+
+} // namespace safe_stack::trace
+
+#endif // SAFE_STACK_TRACE_H
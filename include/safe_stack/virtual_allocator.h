@@ -0,0 +1,102 @@
+#ifndef SAFE_STACK_VIRTUAL_ALLOCATOR_H
+#define SAFE_STACK_VIRTUAL_ALLOCATOR_H
+
+#include "safe_stack/pages.h"
+#include <cstddef>
+#include <new> // for std::bad_alloc
+#include <sys/mman.h>
+
+namespace safe_stack {
+
+/// \brief Allocator which reserves `Reserve` bytes of address space for
+/// every buffer and commits its pages on demand.
+///
+/// allocate() maps the whole range as `PROT_NONE` (no memory is used) and
+/// makes only the requested pages accessible. resize() commits or releases
+/// pages at the end of the range, so the buffer never moves: stack doesn't
+/// copy elements when it grows, and references to them stay valid. Pages
+/// after the committed part stay inaccessible and work as a guard region.
+///
+/// Every buffer takes `Reserve` bytes of address space (64 GiB by default),
+/// so there may be only about two thousand of them in a 47-bit address
+/// space. Works on Linux only.
+template <class T, std::size_t Reserve = (std::size_t{1} << 36)>
+class VirtualAllocator {
+public:
+    using value_type = T;
+
+    /// \brief Size of the address range reserved for every buffer.
+    static constexpr std::size_t reserve = Reserve;
+
+    template <class U>
+    struct rebind {
+        using other = VirtualAllocator<U, Reserve>;
+    };
+
+    VirtualAllocator() noexcept = default;
+
+    template <class U>
+    VirtualAllocator(const VirtualAllocator<U, Reserve> &) noexcept {}
+
+    /// \brief Reserves address space and commits memory for `n` objects.
+    /// \exception std::bad_alloc `n` objects don't fit in `Reserve` bytes or
+    /// memory cannot be mapped.
+    T *allocate(std::size_t n) {
+        check(n);
+        void *memory = mmap(nullptr, Reserve, PROT_NONE,
+                            MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+        if (memory == MAP_FAILED)
+            throw std::bad_alloc{};
+        auto bytes = detail::round_to_pages(n * sizeof(T));
+        if (bytes != 0 &&
+            mprotect(memory, bytes, PROT_READ | PROT_WRITE) != 0) {
+            munmap(memory, Reserve);
+            throw std::bad_alloc{};
+        }
+        return static_cast<T *>(memory);
+    }
+
+    /// \brief Releases the whole reserved range.
+    void deallocate(T *p, std::size_t) noexcept { munmap(p, Reserve); }
+
+    /// \brief Resizes memory of `old_n` objects to fit `new_n` objects in
+    /// place. Released pages are returned to the system.
+    /// \return always true (buffer never moves).
+    /// \exception std::bad_alloc `new_n` objects don't fit in `Reserve` bytes
+    /// or memory cannot be committed.
+    bool resize(T *p, std::size_t old_n, std::size_t new_n) {
+        check(new_n);
+        auto memory = reinterpret_cast<char *>(p);
+        auto old_bytes = detail::round_to_pages(old_n * sizeof(T));
+        auto new_bytes = detail::round_to_pages(new_n * sizeof(T));
+        if (new_bytes > old_bytes) {
+            if (mprotect(memory + old_bytes, new_bytes - old_bytes,
+                         PROT_READ | PROT_WRITE) != 0)
+                throw std::bad_alloc{};
+        } else if (new_bytes < old_bytes) {
+            madvise(memory + new_bytes, old_bytes - new_bytes, MADV_DONTNEED);
+            mprotect(memory + new_bytes, old_bytes - new_bytes, PROT_NONE);
+        }
+        return true;
+    }
+
+    template <class U>
+    bool operator==(const VirtualAllocator<U, Reserve> &) const noexcept {
+        return true;
+    }
+
+    template <class U>
+    bool operator!=(const VirtualAllocator<U, Reserve> &) const noexcept {
+        return false;
+    }
+
+private:
+    static void check(std::size_t n) {
+        if (n > Reserve / sizeof(T))
+            throw std::bad_alloc{};
+    }
+};
+
+} // namespace safe_stack
+
+#endif // SAFE_STACK_VIRTUAL_ALLOCATOR_H
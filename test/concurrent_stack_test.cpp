@@ -0,0 +1,91 @@
+#include "safe_stack/concurrent_stack.h"
+#include "gtest/gtest.h"
+#include <algorithm>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace safe_stack;
+
+TEST(ConcurrentStack, SingleThread) {
+    ConcurrentStack<std::string> s;
+    EXPECT_TRUE(s.empty());
+    EXPECT_EQ(std::nullopt, s.try_pop());
+    EXPECT_EQ(std::nullopt, s.top());
+    EXPECT_THROW(s.pop(), StackUnderflow);
+    s.push("a");
+    s.emplace(2, 'b');
+    EXPECT_EQ(2u, s.size());
+    EXPECT_EQ("bb", s.top());
+    EXPECT_EQ("bb", s.pop());
+    EXPECT_EQ("a", s.try_pop());
+    EXPECT_TRUE(s.empty());
+    s.push("c");
+    s.clear();
+    EXPECT_TRUE(s.empty());
+    EXPECT_TRUE(s.valid());
+}
+
+TEST(ConcurrentStack, EveryElementIsPoppedOnce) {
+    constexpr int threads = 8;
+    constexpr int count = 10000;
+    ConcurrentStack<int> s;
+    std::vector<std::vector<int>> popped(threads);
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; ++t) {
+        workers.emplace_back([&, t] {
+            for (int i = 0; i < count; ++i) {
+                s.push(t * count + i);
+                if (i % 2 == 1) // pop every second element
+                    while (auto value = s.try_pop())
+                        popped[t].push_back(*value);
+            }
+        });
+    }
+    for (auto &worker : workers)
+        worker.join();
+    while (auto value = s.try_pop())
+        popped[0].push_back(*value);
+
+    std::vector<int> all;
+    for (auto &values : popped)
+        all.insert(all.end(), values.begin(), values.end());
+    std::sort(all.begin(), all.end());
+    ASSERT_EQ(static_cast<std::size_t>(threads * count), all.size());
+    for (int i = 0; i < threads * count; ++i)
+        EXPECT_EQ(i, all[i]);
+    EXPECT_TRUE(s.empty());
+    EXPECT_TRUE(s.valid());
+}
+
+TEST(ConcurrentStack, ConstReadsDontWrite) {
+    Stack<int> s;
+    for (int i = 0; i < 1000; ++i)
+        s.push(i);
+    const auto &shared = s;
+    auto reader = [&] {
+        for (int i = 0; i < 10000; ++i)
+            EXPECT_EQ(999, shared.top());
+    };
+    std::thread first{reader};
+    std::thread second{reader};
+    first.join();
+    second.join();
+    EXPECT_TRUE(s.valid());
+}
+
+TEST(ConcurrentStack, StdMutex) {
+    ConcurrentStack<int, std::allocator<int>, checks::Full, std::mutex> s;
+    std::thread first{[&] {
+        for (int i = 0; i < 1000; ++i)
+            s.push(i);
+    }};
+    std::thread second{[&] {
+        for (int i = 0; i < 1000; ++i)
+            s.push(i);
+    }};
+    first.join();
+    second.join();
+    EXPECT_EQ(2000u, s.size());
+}
@@ -0,0 +1,127 @@
+#include "safe_stack/crc32c.h"
+#include "safe_stack/safe_stack.h"
+#include "safe_stack/segmented_stack.h"
+#include "gtest/gtest.h"
+#include <cstdint>
+#include <string>
+#include <utility>
+
+using namespace safe_stack;
+
+TEST(Crc32c, CheckValue) {
+    std::string data = "123456789";
+    EXPECT_EQ(0xE3069283u, crc32c(data.data(), data.size()));
+    EXPECT_EQ(0xE3069283u, crc32c_software(data.data(), data.size()));
+    EXPECT_EQ(0u, crc32c(data.data(), 0));
+}
+
+TEST(Crc32c, ThirtyTwoZeros) {
+    // RFC 3720, B.4
+    unsigned char zeros[32] = {0};
+    EXPECT_EQ(0x8A9136AAu, crc32c(zeros, sizeof(zeros)));
+}
+
+TEST(Crc32c, Parts) {
+    std::string data = "The quick brown fox jumps over the lazy dog";
+    auto whole = crc32c(data.data(), data.size());
+    for (std::size_t i = 0; i <= data.size(); ++i)
+        EXPECT_EQ(whole, crc32c(data.data() + i, data.size() - i,
+                                crc32c(data.data(), i)));
+}
+
+#ifdef SAFE_STACK_CRC32C_SSE42
+TEST(Crc32c, HardwareMatchesSoftware) {
+    if (!crc32c_hardware_available())
+        GTEST_SKIP() << "no SSE4.2";
+    unsigned char data[100];
+    for (int i = 0; i < 100; ++i)
+        data[i] = static_cast<unsigned char>(i * 37 + 11);
+    for (std::size_t offset = 0; offset < 8; ++offset)
+        for (std::size_t size = 0; size + offset <= 100; ++size)
+            EXPECT_EQ(crc32c_software(data + offset, size),
+                      crc32c_hardware(data + offset, size));
+}
+#endif
+
+TEST(Crc32c, StackHasher) {
+    Stack<int, std::allocator<int>, checks::Full, logging::None,
+          hashers::Crc32c>
+        s;
+    for (int i = 0; i < 10; ++i)
+        s.push(i);
+    EXPECT_TRUE(s.valid());
+    reinterpret_cast<unsigned long long *>(&s)[2] += 1; // capacity
+    EXPECT_FALSE(s.valid());
+    reinterpret_cast<unsigned long long *>(&s)[2] -= 1;
+    EXPECT_EQ(9, s.top());
+}
+
+namespace {
+
+/// Checks only the hash, so every detected corruption is detected by it.
+struct OnlyHash : checks::None {
+    static constexpr bool hash = true;
+};
+
+using Crc32cStack =
+    Stack<int, std::allocator<int>, OnlyHash, logging::Callback,
+          hashers::Crc32c>;
+
+std::uint32_t logged_hash;
+
+} // namespace
+
+TEST(Crc32c, StackHashIsCrcOfFields) {
+    logging::Callback::handler = [](const logging::Event &event) {
+        logged_hash = static_cast<std::uint32_t>(event.hash);
+    };
+    Crc32cStack s;
+    s.push(42);
+    logging::Callback::handler = nullptr;
+
+    // stored hash is the 4 bytes after the start canary, data and capacity
+    auto bytes = reinterpret_cast<const unsigned char *>(&s);
+    auto expected = crc32c(bytes + 28, sizeof(s) - 28, crc32c(bytes, 24));
+    EXPECT_EQ(expected, logged_hash);
+}
+
+TEST(Crc32c, SegmentedStackHashIsCrcOfFields) {
+    logging::Callback::handler = [](const logging::Event &event) {
+        logged_hash = static_cast<std::uint32_t>(event.hash);
+    };
+    SegmentedStack<int, std::allocator<int>, OnlyHash, logging::Callback,
+                   hashers::Crc32c>
+        s;
+    s.push(42);
+    logging::Callback::handler = nullptr;
+
+    // stored hash is the 4 bytes after the start canary and two chunks
+    auto bytes = reinterpret_cast<const unsigned char *>(&s);
+    auto expected = crc32c(bytes + 28, sizeof(s) - 28, crc32c(bytes, 24));
+    EXPECT_EQ(expected, logged_hash);
+}
+
+TEST(Crc32c, StackDetectsBurstErrors) {
+    Crc32cStack s;
+    for (int i = 0; i < 10; ++i)
+        s.push(i);
+    auto bytes = reinterpret_cast<unsigned char *>(&s);
+    auto flip = [&](std::size_t first, std::size_t length) {
+        // every bit of the burst is flipped
+        for (auto bit = first; bit < first + length; ++bit)
+            bytes[bit / 8] ^= static_cast<unsigned char>(1u << bit % 8);
+    };
+    // bursts in the data pointer and capacity, and in the size
+    using Bits = std::pair<std::size_t, std::size_t>;
+    for (auto [begin, end] : {Bits{8 * 8, 24 * 8}, Bits{32 * 8, 40 * 8}}) {
+        for (std::size_t length = 1; length <= 32; ++length) {
+            for (auto first = begin; first + length <= end; ++first) {
+                flip(first, length);
+                EXPECT_FALSE(s.valid()) << first << " " << length;
+                flip(first, length);
+            }
+        }
+    }
+    EXPECT_TRUE(s.valid());
+    EXPECT_EQ(9, s.top());
+}
@@ -0,0 +1,93 @@
+#include "safe_stack/growth.h"
+#include "safe_stack/safe_stack.h"
+#include "gtest/gtest.h"
+
+using namespace safe_stack;
+
+namespace {
+
+std::size_t reallocations;
+
+void count_reallocations(const logging::Event &event) {
+    if (event.op == logging::Op::reserve)
+        ++reallocations;
+}
+
+template <class Growth>
+using CountedStack = Stack<int, std::allocator<int>, checks::Full,
+                           logging::Callback, hashers::Word64, Growth>;
+
+/// Pushes `base` elements, then pushes and pops `swing` elements `times`
+/// times. Returns a number of reallocations during the oscillation.
+template <class Growth>
+std::size_t oscillate(int base, int swing, int times) {
+    CountedStack<Growth> s;
+    for (int i = 0; i < base; ++i)
+        s.push(i);
+    reallocations = 0;
+    logging::Callback::handler = count_reallocations;
+    for (int t = 0; t < times; ++t) {
+        for (int i = 0; i < swing; ++i)
+            s.push(i);
+        for (int i = 0; i < swing; ++i)
+            s.pop();
+    }
+    logging::Callback::handler = nullptr;
+    EXPECT_EQ(base, s.size());
+    return reallocations;
+}
+
+} // namespace
+
+TEST(Growth, Hysteresis) {
+    EXPECT_EQ(33u, growth::Hysteresis::grow(16));
+    EXPECT_EQ(100u, growth::Hysteresis::shrink(25, 100));
+    EXPECT_EQ(48u, growth::Hysteresis::shrink(24, 100));
+    EXPECT_EQ(16u, growth::Hysteresis::shrink(0, 100));
+    EXPECT_EQ(16u, growth::Hysteresis::shrink(0, 16));
+}
+
+TEST(Growth, NeverShrink) {
+    EXPECT_EQ(100u, growth::NeverShrink::shrink(0, 100));
+}
+
+TEST(Growth, ThreeHalves) {
+    EXPECT_EQ(151u, growth::ThreeHalves::grow(100));
+    EXPECT_EQ(1000u, growth::ThreeHalves::shrink(198, 1000));
+    EXPECT_EQ(295u, growth::ThreeHalves::shrink(197, 1000));
+    EXPECT_EQ(16u, growth::ThreeHalves::shrink(0, 100));
+}
+
+TEST(Growth, ThreeHalvesFreedBuffersFitNextBuffer) {
+    // while the stack grows from `capacity`, all previous buffers are freed
+    std::size_t freed = 0, previous = 0, capacity = 16;
+    for (int i = 0; i < 10; ++i) {
+        freed += previous;
+        previous = capacity;
+        capacity = growth::ThreeHalves::grow(capacity);
+    }
+    EXPECT_GE(freed, capacity);
+}
+
+TEST(Growth, LegacyReallocatesOnOscillation) {
+    // size drops under 40% of capacity on every cycle
+    EXPECT_GE(oscillate<growth::Legacy>(40, 60, 100), 200u);
+}
+
+TEST(Growth, HysteresisDoesNotReallocateOnOscillation) {
+    // stack grows only in the first cycle
+    EXPECT_LE(oscillate<growth::Hysteresis>(40, 60, 100), 2u);
+    EXPECT_LE(oscillate<growth::NeverShrink>(40, 60, 100), 2u);
+    EXPECT_LE(oscillate<growth::ThreeHalves>(40, 60, 100), 3u); // grows by 1.5
+}
+
+TEST(Growth, HysteresisShrinks) {
+    Stack<int> s;
+    for (int i = 0; i < 1000; ++i)
+        s.push(i);
+    for (int i = 0; i < 1000; ++i)
+        s.pop();
+    EXPECT_TRUE(s.empty());
+    s.push(1);
+    EXPECT_EQ(1, s.top());
+}
@@ -0,0 +1,67 @@
+#include "safe_stack/guarded_allocator.h"
+#include "safe_stack/safe_stack.h"
+#include "gtest/gtest.h"
+#include <new>
+#include <string>
+
+using namespace safe_stack;
+
+namespace {
+
+template <class T>
+using GuardedStack = Stack<T, GuardedAllocator<T>>;
+
+} // namespace
+
+TEST(GuardedAllocator, Stack) {
+    GuardedStack<std::string> s;
+    for (int i = 0; i < 1000; ++i)
+        s.push(std::to_string(i));
+    GuardedStack<std::string> copy{s};
+    for (int i = 999; i >= 0; --i) {
+        EXPECT_EQ(std::to_string(i), copy.top());
+        copy.pop();
+    }
+}
+
+TEST(GuardedAllocator, BlockChecksums) {
+    Stack<int, GuardedAllocator<int>, checks::WithBlocks<checks::Full>> s;
+    for (int i = 0; i < 1000; ++i)
+        s.push(i);
+    EXPECT_NO_THROW(s.deep_validate());
+}
+
+TEST(GuardedAllocator, TooBig) {
+    GuardedAllocator<int> allocator;
+    EXPECT_THROW(allocator.allocate(static_cast<std::size_t>(-1) / 2),
+                 std::bad_array_new_length);
+    EXPECT_THROW(allocator.allocate(allocator.max_size() + 1),
+                 std::bad_array_new_length);
+}
+
+TEST(GuardedAllocator, EndTouchesGuard) {
+    GuardedAllocator<int> allocator;
+    for (std::size_t n : {1, 3, 1000, 1024, 5000}) {
+        auto p = allocator.allocate(n);
+        p[0] = 1;
+        p[n - 1] = 2;
+        auto end = reinterpret_cast<std::uintptr_t>(p + n);
+        EXPECT_EQ(0u, end % detail::page_size());
+        allocator.deallocate(p, n);
+    }
+}
+
+TEST(GuardedAllocatorDeathTest, WritePastEnd) {
+    GuardedAllocator<int> allocator;
+    auto p = allocator.allocate(10);
+    EXPECT_DEATH(p[10] = 42, "");
+    allocator.deallocate(p, 10);
+}
+
+TEST(GuardedAllocatorDeathTest, WriteBeforeBeginning) {
+    GuardedAllocator<int> allocator;
+    auto n = detail::page_size() / sizeof(int);
+    auto p = allocator.allocate(n);
+    EXPECT_DEATH(p[-1] = 42, "");
+    allocator.deallocate(p, n);
+}
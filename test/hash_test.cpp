@@ -20,3 +20,54 @@ TEST(Hash, LastNotNull) {
     EXPECT_EQ(static_cast<HashType>(1 * 31 * 31 * 31 * 31 + data.values[3]),
               hash(data));
 }
+
+namespace {
+
+struct Bytes {
+    unsigned char values[16];
+
+    Bytes() {
+        for (int i = 0; i < 16; ++i)
+            values[i] = static_cast<unsigned char>(i);
+    }
+};
+
+} // namespace
+
+// Vectors are for little-endian machines (words are loaded with memcpy).
+TEST(Word64Hash, Vectors) {
+    Bytes bytes;
+    unsigned char zeros[8] = {0};
+    EXPECT_EQ(0x9ca066f1a4ab2eeaull, hashers::Word64::hash(bytes.values, 0));
+    EXPECT_EQ(0x5e4d6dc50256fcc3ull, hashers::Word64::hash(zeros, 8));
+    EXPECT_EQ(0x062a148c93030557ull, hashers::Word64::hash(bytes.values, 16));
+    EXPECT_EQ(0x196b1969113beb90ull, hashers::Word64::hash(bytes.values, 11));
+    EXPECT_EQ(0x062a148c93030557ull, hash<hashers::Word64>(bytes));
+}
+
+TEST(Word32Hash, Vectors) {
+    Bytes bytes;
+    unsigned char zeros[8] = {0};
+    EXPECT_EQ(0x380b481bu, hashers::Word32::hash(bytes.values, 0));
+    EXPECT_EQ(0x5c1b9106u, hashers::Word32::hash(zeros, 8));
+    EXPECT_EQ(0x952911dbu, hashers::Word32::hash(bytes.values, 16));
+    EXPECT_EQ(0x0850f2f9u, hashers::Word32::hash(bytes.values, 11));
+}
+
+TEST(Word64Hash, EveryBitMatters) {
+    Bytes bytes;
+    auto original = hash<hashers::Word64>(bytes);
+    for (int i = 0; i < 16 * 8; ++i) {
+        bytes.values[i / 8] ^= 1 << (i % 8);
+        EXPECT_NE(original, hash<hashers::Word64>(bytes)) << "bit " << i;
+        bytes.values[i / 8] ^= 1 << (i % 8);
+    }
+}
+
+TEST(Word64Hash, TailLength) {
+    // zero tail bytes must still change the hash
+    unsigned char zeros[16] = {0};
+    for (std::size_t i = 1; i < 16; ++i)
+        EXPECT_NE(hashers::Word64::hash(zeros, i - 1),
+                  hashers::Word64::hash(zeros, i));
+}
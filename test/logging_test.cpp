@@ -0,0 +1,125 @@
+#include "safe_stack/safe_stack.h"
+#include "gtest/gtest.h"
+#include <sstream>
+#include <vector>
+
+using namespace safe_stack;
+
+namespace {
+
+std::vector<logging::Event> events;
+
+void record(const logging::Event &event) { events.push_back(event); }
+
+template <class T>
+using LoggedStack =
+    Stack<T, std::allocator<T>, checks::Full, logging::Callback>;
+
+struct NotPrintable {
+    int value;
+};
+
+} // namespace
+
+TEST(Logging, DefaultIsSilent) {
+    testing::internal::CaptureStderr();
+    {
+        Stack<int> s;
+        s.push(42);
+        s.pop();
+    }
+    EXPECT_EQ("", testing::internal::GetCapturedStderr());
+}
+
+TEST(Logging, Cerr) {
+    testing::internal::CaptureStderr();
+    {
+        Stack<int, std::allocator<int>, checks::Full, logging::Cerr> s;
+        s.push(42);
+    }
+    auto output = testing::internal::GetCapturedStderr();
+    EXPECT_NE(std::string::npos, output.find("push (size 1"));
+    EXPECT_NE(std::string::npos, output.find("destructed"));
+}
+
+TEST(Logging, Events) {
+    events.clear();
+    logging::Callback::handler = record;
+    {
+        LoggedStack<int> s;
+        s.push(1);
+        s.push(2);
+        s.pop();
+    }
+    logging::Callback::handler = nullptr;
+
+    std::vector<logging::Op> ops;
+    for (auto &event : events)
+        ops.push_back(event.op);
+    std::vector<logging::Op> expected{
+        logging::Op::construct, logging::Op::reserve, logging::Op::push,
+        logging::Op::reserve,   logging::Op::push,    logging::Op::pop,
+        logging::Op::destroy};
+    EXPECT_EQ(expected, ops);
+    EXPECT_EQ(2u, events[4].size);
+    EXPECT_EQ(3u, events[4].capacity);
+}
+
+TEST(Logging, InvalidState) {
+    events.clear();
+    logging::Callback::handler = record;
+    {
+        LoggedStack<int> x;
+        LoggedStack<int> y{std::move(x)};
+        EXPECT_THROW(x.size(), StackInvalidState);
+    }
+    logging::Callback::handler = nullptr;
+
+    EXPECT_EQ(logging::Op::invalid_state, events.at(2).op);
+}
+
+TEST(Logging, InvalidBatch) {
+    events.clear();
+    logging::Callback::handler = record;
+    LoggedStack<int> s;
+    {
+        auto batch = s.batch();
+        batch.push(1);
+        auto canary = reinterpret_cast<unsigned long long *>(&s);
+        *canary = 0;
+    } // the destructor reports the failure instead of throwing
+    logging::Callback::handler = nullptr;
+
+    EXPECT_EQ(logging::Op::invalid_state, events.at(events.size() - 1).op);
+}
+
+TEST(Logging, NotPrintableElements) {
+    LoggedStack<NotPrintable> s;
+    s.push({42});
+    EXPECT_EQ(42, s.top().value);
+
+    std::ostringstream out;
+    out << s;
+    EXPECT_NE(std::string::npos, out.str().find("<element>"));
+}
+
+TEST(Logging, RangeIsOneEvent) {
+    events.clear();
+    logging::Callback::handler = record;
+    {
+        LoggedStack<int> s;
+        s.append({1, 2, 3, 4, 5, 6, 7, 8});
+        s.pop_n(8);
+    }
+    logging::Callback::handler = nullptr;
+
+    std::vector<logging::Op> ops;
+    for (auto &event : events)
+        ops.push_back(event.op);
+    std::vector<logging::Op> expected{
+        logging::Op::construct, logging::Op::reserve, logging::Op::push_range,
+        logging::Op::pop_range, logging::Op::destroy};
+    EXPECT_EQ(expected, ops);
+    EXPECT_EQ(8u, events[2].size);
+    EXPECT_EQ(15u, events[2].capacity);
+}
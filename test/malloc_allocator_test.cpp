@@ -0,0 +1,76 @@
+#include "safe_stack/malloc_allocator.h"
+#include "safe_stack/safe_stack.h"
+#include "gtest/gtest.h"
+#include <memory>
+#include <string>
+
+using namespace safe_stack;
+
+namespace {
+
+template <class T, class Policy = checks::Full>
+using MallocStack = Stack<T, MallocAllocator<T>, Policy>;
+
+} // namespace
+
+TEST(MallocAllocator, Reallocate) {
+    MallocAllocator<int> allocator;
+    auto p = allocator.allocate(10);
+    for (int i = 0; i < 10; ++i)
+        p[i] = i;
+    p = allocator.reallocate(p, 10, 100000);
+    for (int i = 0; i < 10; ++i)
+        EXPECT_EQ(i, p[i]);
+    p = allocator.reallocate(p, 100000, 5);
+    for (int i = 0; i < 5; ++i)
+        EXPECT_EQ(i, p[i]);
+    allocator.deallocate(p, 5);
+}
+
+TEST(MallocAllocator, TooBig) {
+    MallocAllocator<int> allocator;
+    EXPECT_THROW(allocator.allocate(static_cast<std::size_t>(-1)),
+                 std::bad_alloc);
+}
+
+TEST(MallocAllocator, StackGrowsAndShrinks) {
+    MallocStack<int, checks::Paranoid> s;
+    for (int i = 0; i < 1000; ++i)
+        s.push(i);
+    for (int i = 999; i >= 0; --i) {
+        EXPECT_EQ(i, s.top());
+        s.pop();
+    }
+    EXPECT_TRUE(s.empty());
+}
+
+TEST(MallocAllocator, BlockChecksums) {
+    MallocStack<int, checks::WithBlocks<checks::Full, 4>> s;
+    for (int i = 0; i < 1000; ++i)
+        s.push(i);
+    EXPECT_NO_THROW(s.deep_validate());
+    int *elements = &s.top() - 999;
+    elements[500] = 0;
+    s.reserve(5000); // corruption is not hidden by reallocation
+    EXPECT_THROW(s.deep_validate(), StackInvalidState);
+}
+
+TEST(MallocAllocator, RelocatableElements) {
+    MallocStack<std::unique_ptr<int>> s;
+    for (int i = 0; i < 1000; ++i)
+        s.push(std::make_unique<int>(i));
+    for (int i = 999; i >= 0; --i) {
+        EXPECT_EQ(i, *s.top());
+        s.pop();
+    }
+}
+
+TEST(MallocAllocator, NonRelocatableElements) {
+    MallocStack<std::string> s;
+    for (int i = 0; i < 1000; ++i)
+        s.push(std::to_string(i));
+    for (int i = 999; i >= 0; --i) {
+        EXPECT_EQ(std::to_string(i), s.top());
+        s.pop();
+    }
+}
@@ -0,0 +1,76 @@
+#include "safe_stack/mmap_allocator.h"
+#include "safe_stack/safe_stack.h"
+#include "gtest/gtest.h"
+#include <string>
+
+using namespace safe_stack;
+
+namespace {
+
+/// Maps every buffer of at least one page.
+template <class T>
+using PageAllocator = MmapAllocator<T, 4096>;
+
+template <class T, class Policy = checks::Full>
+using MmapStack = Stack<T, PageAllocator<T>, Policy>;
+
+} // namespace
+
+TEST(MmapAllocator, CrossThreshold) {
+    PageAllocator<int> allocator;
+    auto p = allocator.allocate(10); // malloc
+    for (int i = 0; i < 10; ++i)
+        p[i] = i;
+    p = allocator.reallocate(p, 10, 100000); // mmap
+    for (int i = 0; i < 10; ++i)
+        EXPECT_EQ(i, p[i]);
+    p[99999] = 42;
+    p = allocator.reallocate(p, 100000, 5); // malloc
+    for (int i = 0; i < 5; ++i)
+        EXPECT_EQ(i, p[i]);
+    allocator.deallocate(p, 5);
+}
+
+TEST(MmapAllocator, ShrinkInPlace) {
+    PageAllocator<int> allocator;
+    auto p = allocator.allocate(100000);
+    p[50000] = 42;
+    auto q = allocator.reallocate(p, 100000, 60000);
+    EXPECT_EQ(p, q); // tail pages are unmapped
+    EXPECT_EQ(42, q[50000]);
+    q = allocator.reallocate(q, 60000, 1000000);
+    EXPECT_EQ(42, q[50000]);
+    allocator.deallocate(q, 1000000);
+}
+
+TEST(MmapAllocator, StackGrowsAndShrinks) {
+    MmapStack<int, checks::WithBlocks<checks::Full>> s;
+    for (int i = 0; i < 100000; ++i)
+        s.push(i);
+    EXPECT_NO_THROW(s.deep_validate());
+    for (int i = 99999; i >= 0; --i) {
+        EXPECT_EQ(i, s.top());
+        s.pop();
+    }
+    EXPECT_NO_THROW(s.deep_validate());
+}
+
+TEST(MmapAllocator, BufferCanaries) {
+    MmapStack<int, checks::WithBufferCanaries<checks::Full>> s;
+    for (int i = 0; i < 16383; ++i) // capacity is 16383 now
+        s.push(i);
+    int *end = &s.top() + 1;
+    *end = 42;
+    EXPECT_THROW(s.size(), StackInvalidState);
+}
+
+TEST(MmapAllocator, NonRelocatableElements) {
+    MmapStack<std::string> s;
+    for (int i = 0; i < 10000; ++i)
+        s.push(std::to_string(i));
+    MmapStack<std::string> copy{s};
+    for (int i = 9999; i >= 0; --i) {
+        EXPECT_EQ(std::to_string(i), copy.top());
+        copy.pop();
+    }
+}
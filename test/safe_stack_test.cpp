@@ -1,7 +1,18 @@
 #include "safe_stack/safe_stack.h"
 #include "gtest/gtest.h"
+#include <cstdint>
 #include <iostream>
+#include <iterator>
+#include <list>
 #include <memory>
+#include <new>
+#include <optional>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
 
 using namespace safe_stack;
 
@@ -128,3 +139,904 @@ TEST_F(ExecutionChamber, CorruptMiddle) {
     *(left + 4) = ~(*(left + 4));
     EXPECT_EQ(0, s.size());
 }
+
+template <class Policy>
+class CheckPolicies : public testing::Test {};
+
+using AllCheckPolicies =
+    testing::Types<checks::None, checks::CanariesOnly, checks::HashOnly,
+                   checks::Full, checks::Paranoid>;
+TYPED_TEST_SUITE(CheckPolicies, AllCheckPolicies);
+
+TYPED_TEST(CheckPolicies, ManyElements) {
+    Stack<int, std::allocator<int>, TypeParam> s;
+    for (int i = 0; i < 100; ++i)
+        s.push(i);
+    EXPECT_TRUE(s.valid());
+    for (int i = 99; i >= 0; --i) {
+        EXPECT_EQ(i, s.top());
+        s.pop();
+    }
+    EXPECT_TRUE(s.empty());
+}
+
+// Stack layout: start canary, data pointer, capacity, hash, ...
+template <class Stack>
+unsigned long long &field(Stack &s, std::size_t index) {
+    return reinterpret_cast<unsigned long long *>(&s)[index];
+}
+
+TEST(CheckPolicy, NoneSkipsEverything) {
+    Stack<int, std::allocator<int>, checks::None> s;
+    field(s, 0) = 0;
+    EXPECT_TRUE(s.valid());
+    EXPECT_EQ(0, s.size());
+}
+
+TEST(CheckPolicy, CanariesOnlySkipsHash) {
+    Stack<int, std::allocator<int>, checks::CanariesOnly> s;
+    s.push(42);
+    field(s, 2) += 1; // capacity
+    EXPECT_TRUE(s.valid());
+    field(s, 2) -= 1;
+
+    field(s, 0) = 0;
+    EXPECT_THROW(s.size(), StackInvalidState);
+    field(s, 0) = 0xDEADBEEFBADF00Dul;
+    EXPECT_EQ(1, s.size());
+}
+
+TEST(CheckPolicy, HashOnlyDetectsFields) {
+    Stack<int, std::allocator<int>, checks::HashOnly> s;
+    s.push(42);
+    field(s, 2) += 1; // capacity
+    EXPECT_THROW(s.size(), StackInvalidState);
+    field(s, 2) -= 1;
+    EXPECT_EQ(1, s.size());
+}
+
+TEST(CheckPolicy, InvariantsDetectMovedOut) {
+    Stack<int, std::allocator<int>, checks::CanariesOnly> x;
+    x.push(42);
+    Stack<int, std::allocator<int>, checks::CanariesOnly> y{std::move(x)};
+    EXPECT_EQ(42, y.top());
+    EXPECT_THROW(x.top(), StackInvalidState);
+}
+
+template <class Hasher>
+class Hashers : public testing::Test {};
+
+using AllHashers =
+    testing::Types<hashers::Byte, hashers::Word32, hashers::Word64>;
+TYPED_TEST_SUITE(Hashers, AllHashers);
+
+TYPED_TEST(Hashers, DetectCorruption) {
+    Stack<int, std::allocator<int>, checks::HashOnly, logging::None, TypeParam>
+        s;
+    s.push(42);
+    field(s, 2) += 1; // capacity
+    EXPECT_THROW(s.size(), StackInvalidState);
+    field(s, 2) -= 1;
+    EXPECT_EQ(1, s.size());
+    EXPECT_EQ(42, s.top());
+}
+
+using PayloadStack = Stack<int, std::allocator<int>,
+                           checks::WithPayload<checks::Full>>;
+
+TEST(Payload, ChangeTop) {
+    PayloadStack s;
+    for (int i = 0; i < 10; ++i)
+        s.push(i);
+    s.top() = 42; // top element may be changed
+    EXPECT_NO_THROW(s.deep_validate());
+    s.pop();
+    s.top() = 13;
+    s.push(1);
+    EXPECT_NO_THROW(s.deep_validate());
+}
+
+TEST(Payload, CorruptElement) {
+    PayloadStack s;
+    for (int i = 0; i < 10; ++i)
+        s.push(i);
+    int *elements = &s.top() - 9;
+    elements[3] = 42;
+    EXPECT_NO_THROW(s.size()); // only header is checked
+    EXPECT_THROW(s.deep_validate(), StackInvalidState);
+    elements[3] = 3;
+    EXPECT_NO_THROW(s.deep_validate());
+}
+
+TEST(Payload, SwapElements) {
+    PayloadStack s;
+    for (int i = 0; i < 10; ++i)
+        s.push(i);
+    int *elements = &s.top() - 9;
+    std::swap(elements[2], elements[5]);
+    EXPECT_THROW(s.deep_validate(), StackInvalidState);
+}
+
+TEST(Payload, CorruptionIsRemembered) {
+    PayloadStack s;
+    for (int i = 0; i < 10; ++i)
+        s.push(i);
+    int *elements = &s.top() - 9;
+    elements[8] = 42;
+    s.pop(); // corrupted element becomes top
+    EXPECT_THROW(s.deep_validate(), StackInvalidState);
+}
+
+TEST(Payload, CopyAndReallocate) {
+    PayloadStack x;
+    for (int i = 0; i < 100; ++i)
+        x.push(i);
+    PayloadStack y{x};
+    EXPECT_NO_THROW(y.deep_validate());
+    for (int i = 0; i < 90; ++i)
+        y.pop(); // shrinks
+    EXPECT_NO_THROW(y.deep_validate());
+    x = y;
+    EXPECT_NO_THROW(x.deep_validate());
+    EXPECT_EQ(9, x.top());
+}
+
+TEST(Payload, ParanoidChecksElements) {
+    Stack<int, std::allocator<int>, checks::Paranoid> s;
+    for (int i = 0; i < 10; ++i)
+        s.push(i);
+    int *elements = &s.top() - 9;
+    elements[0] = 42;
+    EXPECT_THROW(s.size(), StackInvalidState);
+    elements[0] = 0;
+    EXPECT_EQ(10, s.size());
+}
+
+TEST(Construction, CopyEmpty) {
+    Stack<int> x;
+    Stack<int> y{x};
+    EXPECT_TRUE(y.empty());
+    y = x;
+    EXPECT_TRUE(y.empty());
+}
+
+template <std::size_t BlockSize>
+using BlockStack = Stack<int, std::allocator<int>,
+                         checks::WithBlocks<checks::Full, BlockSize>>;
+
+TEST(Blocks, PushPop) {
+    BlockStack<4> s;
+    for (int i = 0; i < 100; ++i)
+        s.push(i);
+    EXPECT_NO_THROW(s.deep_validate());
+    for (int i = 99; i >= 0; --i) {
+        EXPECT_EQ(i, s.top());
+        s.top() = -i; // top element may be changed
+        s.pop();
+    }
+    EXPECT_NO_THROW(s.deep_validate());
+}
+
+TEST(Blocks, TopChecksLastBlock) {
+    BlockStack<4> s;
+    for (int i = 0; i < 10; ++i)
+        s.push(i);
+    int *elements = &s.top() - 9;
+
+    elements[0] = 42; // first block isn't checked by top()
+    EXPECT_EQ(9, s.top());
+    EXPECT_THROW(s.deep_validate(), StackInvalidState);
+    elements[0] = 0;
+
+    elements[8] = 42; // last block
+    EXPECT_THROW(s.top(), StackInvalidState);
+    elements[8] = 8;
+    EXPECT_NO_THROW(s.deep_validate());
+}
+
+TEST(Blocks, CorruptionIsRemembered) {
+    BlockStack<4> s;
+    for (int i = 0; i < 6; ++i)
+        s.push(i);
+    int *elements = &s.top() - 5;
+    s.pop(); // top is 4, first block sealed
+    elements[3] = 42;
+    s.pop(); // corrupted element becomes top
+    EXPECT_THROW(s.top(), StackInvalidState);
+}
+
+TEST(Blocks, ParallelDeepValidate) {
+    BlockStack<16> s;
+    for (int i = 0; i < 100000; ++i)
+        s.push(i);
+    EXPECT_NO_THROW(s.deep_validate());
+    int *elements = &s.top() - 99999;
+    elements[54321] = 0;
+    EXPECT_THROW(s.deep_validate(), StackInvalidState);
+    elements[54321] = 54321;
+
+    BlockStack<16> copy{s};
+    EXPECT_NO_THROW(copy.deep_validate());
+    BlockStack<16> moved{std::move(copy)};
+    EXPECT_NO_THROW(moved.deep_validate());
+    EXPECT_EQ(100000, moved.size());
+}
+
+TEST(Blocks, ParanoidChecksAllBlocks) {
+    Stack<int, std::allocator<int>, checks::WithBlocks<checks::Paranoid, 4>> s;
+    for (int i = 0; i < 100; ++i)
+        s.push(i);
+    int *elements = &s.top() - 99;
+    elements[0] = 42; // not in the last block
+    EXPECT_THROW(s.top(), StackInvalidState);
+    EXPECT_EQ(nullptr, s.try_top());
+    elements[0] = 0;
+    EXPECT_EQ(99, s.top());
+}
+
+namespace {
+
+bool fail_blocks = false;
+
+/// Fails to allocate checksums of blocks if `fail_blocks` is set.
+template <class T>
+struct BlockFailingAllocator : std::allocator<T> {
+    template <class U>
+    struct rebind {
+        using other = BlockFailingAllocator<U>;
+    };
+
+    BlockFailingAllocator() = default;
+    template <class U>
+    BlockFailingAllocator(const BlockFailingAllocator<U> &) noexcept {}
+
+    T *allocate(std::size_t n) {
+        if (std::is_same_v<T, std::uint64_t> && fail_blocks)
+            throw std::bad_alloc{};
+        return std::allocator<T>::allocate(n);
+    }
+};
+
+} // namespace
+
+TEST(Blocks, FailedAllocationKeepsStack) {
+    Stack<int, BlockFailingAllocator<int>,
+          checks::WithBlocks<checks::Full, 4>>
+        s;
+    s.reserve(8);
+    for (int i = 0; i < 8; ++i) // the buffer is full
+        s.push(i);
+    fail_blocks = true;
+    EXPECT_EQ(Status::overflow, s.try_push(42));
+    EXPECT_THROW(s.push(42), std::bad_alloc);
+    fail_blocks = false;
+    EXPECT_NO_THROW(s.deep_validate());
+    EXPECT_EQ(8, s.size());
+    EXPECT_EQ(7, s.top());
+    s.push(42);
+    EXPECT_NO_THROW(s.deep_validate());
+}
+
+namespace {
+
+/// Allocator which can resize buffers in place (like VirtualAllocator),
+/// counts allocations of checksums of blocks.
+template <class T>
+struct ResizingAllocator : std::allocator<T> {
+    static inline std::size_t allocations = 0;
+
+    template <class U>
+    struct rebind {
+        using other = ResizingAllocator<U>;
+    };
+
+    ResizingAllocator() = default;
+    template <class U>
+    ResizingAllocator(const ResizingAllocator<U> &) noexcept {}
+
+    T *allocate(std::size_t n) {
+        allocations += 1;
+        return std::allocator<T>::allocate(n);
+    }
+
+    bool resize(T *, std::size_t, std::size_t) { return false; }
+};
+
+} // namespace
+
+TEST(Blocks, NotAllocatedByResizingAllocator) {
+    Stack<int, ResizingAllocator<int>, checks::WithBlocks<checks::Full, 4>>
+        s;
+    for (int i = 0; i < 1000; ++i)
+        s.push(i);
+    EXPECT_NO_THROW(s.deep_validate());
+    EXPECT_NE(0u, ResizingAllocator<int>::allocations);
+    EXPECT_EQ(0u, ResizingAllocator<std::uint64_t>::allocations);
+}
+
+using BufferCanaryStack =
+    Stack<int, std::allocator<int>, checks::WithBufferCanaries<checks::Full>>;
+
+TEST(BufferCanaries, WritePastEnd) {
+    BufferCanaryStack s;
+    for (int i = 0; i < 7; ++i) // capacity is 7 now
+        s.push(i);
+    int *end = &s.top() + 1;
+    int saved = *end;
+    *end = 42;
+    EXPECT_FALSE(s.valid());
+    EXPECT_THROW(s.size(), StackInvalidState);
+    *end = saved;
+    EXPECT_EQ(7, s.size());
+}
+
+TEST(BufferCanaries, WriteBeforeBeginning) {
+    BufferCanaryStack s;
+    s.push(1);
+    int *before = &s.top() - 1;
+    int saved = *before;
+    *before = 42;
+    EXPECT_THROW(s.top(), StackInvalidState);
+    *before = saved;
+    EXPECT_EQ(1, s.top());
+}
+
+TEST(BufferCanaries, Strings) {
+    Stack<std::string, std::allocator<std::string>,
+          checks::WithBufferCanaries<checks::Full>>
+        s;
+    for (int i = 0; i < 100; ++i)
+        s.push(std::to_string(i));
+    auto copy = s;
+    for (int i = 99; i >= 0; --i) {
+        EXPECT_EQ(std::to_string(i), copy.top());
+        copy.pop();
+    }
+}
+
+static_assert(is_trivially_relocatable_v<int>);
+static_assert(is_trivially_relocatable_v<std::unique_ptr<int>>);
+static_assert(!is_trivially_relocatable_v<std::string>);
+
+TEST(Relocation, UniquePointers) {
+    Stack<std::unique_ptr<int>> s;
+    for (int i = 0; i < 100; ++i)
+        s.push(std::make_unique<int>(i));
+    s.reserve(10); // extra elements are destroyed
+    EXPECT_EQ(10, s.size());
+    for (int i = 9; i >= 0; --i) {
+        EXPECT_EQ(i, *s.top());
+        s.pop();
+    }
+}
+
+TEST(Relocation, BlocksSurviveReallocation) {
+    BlockStack<4> s;
+    for (int i = 0; i < 100; ++i)
+        s.push(i);
+    s.reserve(1000);
+    EXPECT_NO_THROW(s.deep_validate());
+    s.reserve(50); // drops elements
+    EXPECT_EQ(49, s.top());
+    EXPECT_NO_THROW(s.deep_validate());
+}
+
+TEST(Relocation, CopyKeepsCorruption) {
+    PayloadStack s;
+    for (int i = 0; i < 10; ++i)
+        s.push(i);
+    int *elements = &s.top() - 9;
+    elements[3] = 42;
+    PayloadStack copy{s};
+    EXPECT_THROW(copy.deep_validate(), StackInvalidState);
+}
+
+namespace {
+
+/// Checks if `p` points inside the stack object.
+template <class Stack, class T>
+bool is_inside(const Stack &s, const T *p) {
+    auto begin = reinterpret_cast<const char *>(&s);
+    auto pointer = reinterpret_cast<const char *>(p);
+    return begin <= pointer && pointer < begin + sizeof(s);
+}
+
+} // namespace
+
+TEST(SmallStack, InlineElements) {
+    SmallStack<int, 16> s;
+    for (int i = 0; i < 16; ++i) {
+        s.push(i);
+        EXPECT_TRUE(is_inside(s, &s.top()));
+    }
+    s.push(16); // spills to the heap
+    EXPECT_FALSE(is_inside(s, &s.top()));
+    for (int i = 0; i < 100; ++i)
+        s.push(i);
+    for (int i = 0; i < 110; ++i)
+        s.pop();
+    EXPECT_TRUE(is_inside(s, &s.top())); // and comes back
+    EXPECT_EQ(7, s.size());
+    EXPECT_EQ(6, s.top());
+}
+
+TEST(SmallStack, HashCoversElements) {
+    SmallStack<int, 16> s;
+    for (int i = 0; i < 10; ++i)
+        s.push(i);
+    s.top() = 42; // top element may be changed
+    EXPECT_EQ(10, s.size());
+    int *elements = &s.top() - 9;
+    elements[3] = 42;
+    EXPECT_THROW(s.size(), StackInvalidState);
+    elements[3] = 3;
+    EXPECT_EQ(10, s.size());
+}
+
+TEST(SmallStack, CopyAndMove) {
+    SmallStack<std::string, 4> x;
+    for (int i = 0; i < 3; ++i)
+        x.push(std::to_string(i));
+    SmallStack<std::string, 4> y{x};
+    EXPECT_EQ("2", y.top());
+    SmallStack<std::string, 4> z{std::move(y)};
+    EXPECT_THROW(y.size(), StackInvalidState);
+    EXPECT_TRUE(is_inside(z, &z.top()));
+    EXPECT_EQ("2", z.top());
+    z.pop();
+    x = std::move(z);
+    EXPECT_EQ("1", x.top());
+    EXPECT_TRUE(is_inside(x, &x.top()));
+}
+
+TEST(SmallStack, ParanoidChecks) {
+    SmallStack<int, 16, std::allocator<int>,
+               checks::WithBlocks<checks::Paranoid, 4>>
+        s;
+    for (int i = 0; i < 40; ++i)
+        s.push(i);
+    for (int i = 0; i < 35; ++i)
+        s.pop();
+    EXPECT_TRUE(is_inside(s, &s.top()));
+    int *end = &s.top() - 4 + 16; // buffer canary after inline elements
+    int canary = std::exchange(*end, 42);
+    EXPECT_THROW(s.size(), StackInvalidState);
+    *end = canary;
+    EXPECT_EQ(5u, s.size());
+}
+
+TEST(TryApi, PushPopTop) {
+    Stack<std::string> s;
+    EXPECT_EQ(nullptr, s.try_top());
+    EXPECT_EQ(std::nullopt, s.try_pop());
+    for (int i = 0; i < 100; ++i)
+        EXPECT_EQ(Status::ok, s.try_push(std::to_string(i)));
+    std::string last = "100";
+    EXPECT_EQ(Status::ok, s.try_push(last));
+    EXPECT_EQ(Status::ok, s.try_emplace(3, 'x'));
+    ASSERT_NE(nullptr, s.try_top());
+    EXPECT_EQ("xxx", *s.try_top());
+    EXPECT_EQ("xxx", s.try_pop());
+    EXPECT_EQ("100", *std::as_const(s).try_top());
+
+    int count = 0;
+    while (auto value = s.try_pop())
+        EXPECT_EQ(std::to_string(100 - count++), *value);
+    EXPECT_EQ(101, count);
+    EXPECT_TRUE(s.empty());
+}
+
+TEST(TryApi, InvalidState) {
+    Stack<int> s;
+    s.push(42);
+    field(s, 0) = 0;
+    EXPECT_EQ(Status::invalid_state, s.try_push(1));
+    EXPECT_EQ(nullptr, s.try_top());
+    EXPECT_EQ(std::nullopt, s.try_pop());
+    field(s, 0) = 0xDEADBEEFBADF00Dul;
+    EXPECT_EQ(42, s.try_pop());
+
+    Stack<int> moved{std::move(s)};
+    EXPECT_EQ(Status::invalid_state, s.try_push(1));
+    EXPECT_EQ(std::nullopt, s.try_pop());
+}
+
+TEST(TryApi, CorruptedBlock) {
+    Stack<int, std::allocator<int>, checks::WithBlocks<checks::Full, 4>> s;
+    for (int i = 0; i < 10; ++i)
+        s.push(i);
+    int *sealed = s.try_top() - 1;
+    *sealed = 13;
+    EXPECT_EQ(nullptr, s.try_top());
+    *sealed = 8;
+    EXPECT_EQ(9, *s.try_top());
+}
+
+TEST(TryApi, Noexcept) {
+    Stack<int> s;
+    static_assert(noexcept(s.try_push(1)));
+    static_assert(noexcept(s.try_pop()));
+    static_assert(noexcept(s.try_top()));
+
+    // growing the buffer moves elements, their exceptions propagate
+    struct ThrowingMove {
+        ThrowingMove() noexcept = default;
+        ThrowingMove(const ThrowingMove &) noexcept = default;
+        ThrowingMove(ThrowingMove &&) noexcept(false) {}
+    };
+    Stack<ThrowingMove> t;
+    ThrowingMove value;
+    static_assert(!noexcept(t.try_push(value)));
+    static_assert(!noexcept(t.try_emplace()));
+    static_assert(noexcept(t.try_top()));
+}
+
+TEST(TryApi, TopChecksLazyHash) {
+    Stack<int, std::allocator<int>, checks::WithLazyHash<checks::Full, 0, true>>
+        s;
+    s.push(42);
+    field(s, 2) += 1; // capacity
+    EXPECT_EQ(nullptr, s.try_top()); // like top(), the read checks the hash
+    field(s, 2) -= 1;
+    EXPECT_EQ(42, *s.try_top());
+}
+
+TEST(PopValue, MovesElementOut) {
+    Stack<std::string> s;
+    for (int i = 0; i < 100; ++i)
+        s.push(std::to_string(i));
+    EXPECT_EQ("99", s.pop_value());
+    std::string out;
+    s.pop_into(out);
+    EXPECT_EQ("98", out);
+    EXPECT_EQ(98, s.size());
+    while (!s.empty())
+        out = s.pop_value();
+    EXPECT_EQ("0", out);
+    EXPECT_THROW(s.pop_value(), StackUnderflow);
+    EXPECT_THROW(s.pop_into(out), StackUnderflow);
+}
+
+TEST(PopValue, MoveOnlyElements) {
+    Stack<std::unique_ptr<int>> s;
+    s.push(std::make_unique<int>(1));
+    s.push(std::make_unique<int>(2));
+    auto p = s.pop_value();
+    EXPECT_EQ(2, *p);
+    s.pop_into(p);
+    EXPECT_EQ(1, *p);
+    EXPECT_TRUE(s.empty());
+}
+
+TEST(PopValue, KeepsPayload) {
+    Stack<int, std::allocator<int>, checks::WithBlocks<checks::Paranoid, 4>> s;
+    for (int i = 0; i < 40; ++i)
+        s.push(i);
+    for (int i = 39; i >= 0; --i)
+        EXPECT_EQ(i, s.pop_value());
+    EXPECT_NO_THROW(s.deep_validate());
+}
+
+TEST(Bulk, PushRange) {
+    std::vector<int> values(100);
+    for (int i = 0; i < 100; ++i)
+        values[i] = i;
+    Stack<int> s;
+    s.push(-1);
+    s.push_range(values.data(), values.data() + values.size());
+    s.push_range(values.begin(), values.begin());
+    EXPECT_EQ(101, s.size());
+    EXPECT_EQ(99, s.top());
+
+    std::list<std::string> strings{"a", "b", "c"};
+    Stack<std::string> t;
+    t.push_range(strings.begin(), strings.end());
+    t.append({"d", "e"});
+    EXPECT_EQ(5, t.size());
+    EXPECT_EQ("e", t.pop_value());
+    EXPECT_EQ("d", t.pop_value());
+    EXPECT_EQ("c", t.pop_value());
+}
+
+TEST(Bulk, PushRangeOfOwnElements) {
+    Stack<int> s;
+    s.reserve(4);
+    s.append({1, 2, 3, 4});
+    int *top = &s.top();
+    s.push_range(top - 2, top + 1); // the buffer is full, it is reallocated
+    EXPECT_EQ(7, s.size());
+    EXPECT_EQ(4, s.pop_value());
+    EXPECT_EQ(3, s.pop_value());
+    EXPECT_EQ(2, s.pop_value());
+
+    Stack<std::string, std::allocator<std::string>,
+          checks::WithPayload<checks::Paranoid>>
+        t;
+    t.reserve(3);
+    t.append({std::string(32, 'a'), std::string(32, 'b'), "c"});
+    std::reverse_iterator<std::string *> last{&t.top() + 1};
+    t.push_range(last, last + 3);
+    EXPECT_EQ(6, t.size());
+    EXPECT_EQ(std::string(32, 'a'), t.pop_value());
+    EXPECT_EQ(std::string(32, 'b'), t.pop_value());
+    EXPECT_EQ("c", t.pop_value());
+}
+
+TEST(Bulk, PushOwnTop) {
+    Stack<std::string> s;
+    s.reserve(2);
+    s.push(std::string(32, 'a'));
+    s.push(std::string(32, 'b'));
+    s.push(s.top()); // the buffer is full, it is reallocated
+    EXPECT_EQ(Status::ok, s.try_push(s.top())); // reallocated again
+    s.push(s.top());
+    EXPECT_EQ(5, s.size());
+    for (int i = 0; i < 4; ++i)
+        EXPECT_EQ(std::string(32, 'b'), s.pop_value());
+    EXPECT_EQ(std::string(32, 'a'), s.top());
+
+    s.reserve(1);
+    {
+        decltype(s)::Batch batch{s};
+        batch.push(batch.top());
+    }
+    EXPECT_EQ(2, s.size());
+    EXPECT_EQ(std::string(32, 'a'), s.top());
+}
+
+TEST(Bulk, PushInputRange) {
+    std::istringstream input{"1 2 3 4 5 6 7 8 9 10 11 12 13 14 15 16 17 18"};
+    Stack<int, std::allocator<int>, checks::WithBlocks<checks::Paranoid, 4>> s;
+    s.push(0);
+    s.push_range(std::istream_iterator<int>{input},
+                 std::istream_iterator<int>{});
+    EXPECT_EQ(19, s.size());
+    EXPECT_NO_THROW(s.deep_validate());
+    for (int i = 18; i >= 0; --i)
+        EXPECT_EQ(i, s.pop_value());
+}
+
+TEST(Bulk, PopN) {
+    Stack<int, std::allocator<int>, checks::WithBlocks<checks::Paranoid, 4>> s;
+    s.append({0, 1, 2, 3, 4, 5, 6, 7, 8, 9});
+    EXPECT_NO_THROW(s.deep_validate());
+    s.pop_n(3);
+    EXPECT_EQ(7, s.size());
+    EXPECT_EQ(6, s.top());
+    EXPECT_THROW(s.pop_n(8), StackUnderflow);
+    EXPECT_EQ(7, s.size());
+    s.pop_n(0);
+    s.pop_n(7);
+    EXPECT_TRUE(s.empty());
+    EXPECT_NO_THROW(s.deep_validate());
+}
+
+TEST(Bulk, PopNInto) {
+    Stack<std::unique_ptr<int>> s;
+    for (int i = 0; i < 40; ++i)
+        s.push(std::make_unique<int>(i));
+    std::vector<std::unique_ptr<int>> out;
+    s.pop_n_into(std::back_inserter(out), 30);
+    ASSERT_EQ(30, out.size());
+    EXPECT_EQ(39, *out.front());
+    EXPECT_EQ(10, *out.back());
+    EXPECT_EQ(10, s.size());
+    EXPECT_EQ(9, *s.top());
+    EXPECT_THROW(s.pop_n_into(std::back_inserter(out), 11), StackUnderflow);
+    EXPECT_EQ(30, out.size());
+}
+
+TEST(Bulk, PopNIntoKeepsChecksums) {
+    using Strings = Stack<std::string, std::allocator<std::string>,
+                          checks::WithBlocks<checks::Paranoid, 4>>;
+    Strings s;
+    for (int i = 0; i < 10; ++i)
+        s.push(std::string(32, static_cast<char>('a' + i))); // no SSO
+    std::vector<std::string> out;
+    s.pop_n_into(std::back_inserter(out), 3);
+    EXPECT_EQ(std::string(32, 'j'), out.front());
+    EXPECT_EQ(7, s.size());
+    EXPECT_NO_THROW(s.deep_validate());
+    s.push("x");
+    EXPECT_EQ(3, s.pop_n_into(out.begin(), 3) - out.begin());
+    EXPECT_EQ(std::string(32, 'f'), out[2]);
+    EXPECT_NO_THROW(s.deep_validate());
+}
+
+TEST(Bulk, PopNIntoThrowingOutput) {
+    struct Output {
+        int *moved;
+
+        Output &operator*() { return *this; }
+        Output &operator++() { return *this; }
+        Output operator++(int) { return *this; }
+        Output &operator=(std::string &&) {
+            if (++*moved == 3)
+                throw std::runtime_error{"full"};
+            return *this;
+        }
+    };
+    Stack<std::string, std::allocator<std::string>,
+          checks::WithPayload<checks::Paranoid>>
+        s;
+    for (int i = 0; i < 10; ++i)
+        s.push(std::string(32, static_cast<char>('a' + i)));
+    int moved = 0;
+    EXPECT_THROW(s.pop_n_into(Output{&moved}, 5), std::runtime_error);
+    EXPECT_EQ(8, s.size()); // the third element stays
+    EXPECT_NO_THROW(s.deep_validate());
+    EXPECT_EQ(std::string(32, 'h'), s.pop_value());
+}
+
+TEST(Batch, Operations) {
+    Stack<std::string> s;
+    s.push("x");
+    {
+        auto batch = s.batch();
+        for (int i = 0; i < 100; ++i)
+            batch.push(std::to_string(i));
+        batch.emplace(2, 'y');
+        EXPECT_EQ("yy", batch.pop_value());
+        batch.top() = "top";
+        batch.pop();
+        EXPECT_EQ(100, batch.size());
+        EXPECT_FALSE(batch.empty());
+    }
+    EXPECT_TRUE(s.valid());
+    EXPECT_EQ(100, s.size());
+    EXPECT_EQ("98", s.top());
+}
+
+TEST(Batch, CommitValidates) {
+    Stack<int> s;
+    auto batch = s.batch();
+    batch.push(42);
+    field(s, 0) = 0;
+    EXPECT_THROW(batch.commit(), StackInvalidState);
+    EXPECT_THROW(s.top(), StackInvalidState);
+    EXPECT_THROW(s.batch(), StackInvalidState);
+}
+
+TEST(Batch, DestructorDoesNotThrow) {
+    Stack<int> s;
+    {
+        auto batch = s.batch();
+        batch.push(42);
+        field(s, 0) = 0;
+    } // the stack is invalid, but the batch isn't committed explicitly
+    EXPECT_THROW(s.top(), StackInvalidState);
+
+    Stack<int> t;
+    try {
+        auto batch = t.batch();
+        batch.push(42);
+        field(t, 0) = 0;
+        batch.pop();
+        batch.pop(); // unwinds through the batch
+    } catch (const StackUnderflow &) {
+    }
+    EXPECT_THROW(t.top(), StackInvalidState);
+}
+
+TEST(Batch, Underflow) {
+    Stack<int, std::allocator<int>, checks::WithBlocks<checks::Paranoid, 4>> s;
+    try {
+        auto batch = s.batch();
+        for (int i = 0; i < 10; ++i)
+            batch.push(i);
+        for (int i = 0; i < 11; ++i)
+            batch.pop();
+    } catch (const StackUnderflow &) {
+    }
+    EXPECT_TRUE(s.empty());
+    EXPECT_NO_THROW(s.deep_validate());
+}
+
+TEST(Batch, InlineElements) {
+    SmallStack<int, 16, std::allocator<int>, checks::Paranoid> s;
+    {
+        auto batch = s.batch();
+        for (int i = 0; i < 40; ++i)
+            batch.push(i);
+        for (int i = 0; i < 35; ++i)
+            batch.pop();
+    }
+    EXPECT_EQ(5, s.size());
+    EXPECT_EQ(4, s.top());
+}
+
+using LazyStack =
+    Stack<int, std::allocator<int>, checks::WithLazyHash<checks::Full>>;
+
+TEST(LazyHash, CorruptionIsDetectedAtCheckpoint) {
+    LazyStack s;
+    s.reserve(100);
+    s.push(1);
+    field(s, 2) += 1;              // capacity
+    EXPECT_EQ(1, s.size());        // reads don't check the hash
+    EXPECT_NO_THROW(s.push(2));    // push doesn't sign the corruption
+    EXPECT_THROW(s.checkpoint(), StackInvalidState);
+    EXPECT_FALSE(s.valid());
+    field(s, 2) -= 1;
+    EXPECT_NO_THROW(s.checkpoint());
+    EXPECT_EQ(2, s.pop_value());
+    EXPECT_TRUE(s.valid());
+}
+
+TEST(LazyHash, CheckedEveryInterval) {
+    Stack<int, std::allocator<int>, checks::WithLazyHash<checks::Full, 4>> s;
+    s.reserve(100);
+    s.push(1);
+    field(s, 2) += 1; // capacity
+    s.push(2);
+    s.push(3);
+    EXPECT_THROW(s.push(4), StackInvalidState); // checked after 4 mutations
+    field(s, 2) -= 1;
+    EXPECT_EQ(4, s.size());
+    EXPECT_EQ(4, s.top());
+    EXPECT_TRUE(s.valid());
+}
+
+TEST(LazyHash, CheckOnRead) {
+    Stack<int, std::allocator<int>,
+          checks::WithLazyHash<checks::WithPayload<checks::Full>, 0, true>>
+        s;
+    for (int i = 0; i < 100; ++i)
+        s.push(i);
+    field(s, 2) += 1; // capacity
+    EXPECT_THROW(s.top(), StackInvalidState);
+    field(s, 2) -= 1;
+    EXPECT_EQ(99, s.top());
+    s.pop_n(50);
+    EXPECT_NO_THROW(s.deep_validate());
+}
+
+TEST(LazyHash, Batch) {
+    LazyStack s;
+    {
+        auto batch = s.batch();
+        for (int i = 0; i < 10; ++i)
+            batch.push(i);
+    }
+    field(s, 2) += 1; // batch commit recomputes the hash
+    EXPECT_FALSE(s.valid());
+    field(s, 2) -= 1;
+    EXPECT_EQ(9, s.pop_value());
+}
+
+TEST(Sampled, ReadsAreSampled) {
+    Stack<int, std::allocator<int>, checks::Sampled<checks::Full, 4>> s;
+    s.push(42);
+    field(s, 2) += 1; // capacity
+    for (int i = 0; i < 3; ++i)
+        EXPECT_EQ(42, s.top());
+    EXPECT_THROW(s.top(), StackInvalidState);
+    EXPECT_THROW(s.push(1), StackInvalidState); // mutations check everything
+    field(s, 2) -= 1;
+
+    auto stats = s.stats();
+    EXPECT_EQ(4u, stats.reads);
+    EXPECT_EQ(1u, stats.full_checks);
+    EXPECT_EQ(4u, stats.sample_period);
+
+    s.set_sample_period(1);
+    field(s, 0) = 0; // canaries are checked always
+    EXPECT_EQ(nullptr, s.try_top());
+    field(s, 0) = 0xDEADBEEFBADF00Dul;
+    field(s, 2) += 1;
+    EXPECT_EQ(nullptr, s.try_top());
+    field(s, 2) -= 1;
+    EXPECT_EQ(42, *s.try_top());
+    EXPECT_EQ(4u, s.stats().full_checks);
+}
+
+TEST(Sampled, Random) {
+    Stack<int, std::allocator<int>, checks::Sampled<checks::Full, 4, true>> s;
+    s.push(42);
+    for (int i = 0; i < 1000; ++i)
+        s.top();
+    auto stats = s.stats();
+    EXPECT_EQ(1000u, stats.reads);
+    EXPECT_GT(stats.full_checks, 150u);
+    EXPECT_LT(stats.full_checks, 350u);
+}
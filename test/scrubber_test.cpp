@@ -0,0 +1,122 @@
+#include "safe_stack/safe_stack.h"
+#include "safe_stack/scrubber.h"
+#include "gtest/gtest.h"
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+using namespace safe_stack;
+
+namespace {
+
+template <class T, class Policy = checks::Full>
+using ScrubbedStack =
+    Stack<T, std::allocator<T>, checks::WithScrubber<Policy>>;
+
+// Stack layout: start canary, data pointer, capacity, hash, ...
+template <class Stack>
+unsigned long long &field(Stack &s, std::size_t index) {
+    return reinterpret_cast<unsigned long long *>(&s)[index];
+}
+
+} // namespace
+
+TEST(Scrubber, Registration) {
+    auto &scrubber = scrub::Scrubber::instance();
+    auto before = scrubber.size();
+    {
+        ScrubbedStack<int> x;
+        x.push(42);
+        ScrubbedStack<int> y{x};
+        EXPECT_EQ(before + 2, scrubber.size());
+        ScrubbedStack<int> z{std::move(x)}; // moved-out stack is removed
+        EXPECT_EQ(before + 2, scrubber.size());
+        EXPECT_EQ(0u, scrubber.scrub());
+    }
+    EXPECT_EQ(before, scrubber.size());
+}
+
+TEST(Scrubber, DetectsCorruption) {
+    auto &scrubber = scrub::Scrubber::instance();
+    std::vector<const void *> reported;
+    scrubber.set_handler([&](const void *stack) { reported.push_back(stack); });
+
+    ScrubbedStack<int> s;
+    s.push(42);
+    field(s, 2) += 1; // capacity
+    EXPECT_EQ(1u, scrubber.scrub());
+    field(s, 2) -= 1;
+    EXPECT_EQ(0u, scrubber.scrub());
+    scrubber.set_handler(nullptr);
+    ASSERT_EQ(1u, reported.size());
+    EXPECT_EQ(&s, reported.front());
+    EXPECT_EQ(42, s.top());
+}
+
+TEST(Scrubber, HandlerMayCreateStacks) {
+    auto &scrubber = scrub::Scrubber::instance();
+    auto before = scrubber.size();
+    std::size_t registered = 0;
+    scrubber.set_handler([&](const void *) {
+        ScrubbedStack<int> other; // registration doesn't deadlock
+        registered = scrubber.size();
+    });
+
+    ScrubbedStack<int> s;
+    s.push(42);
+    field(s, 2) += 1; // capacity
+    EXPECT_EQ(1u, scrubber.scrub());
+    field(s, 2) -= 1;
+    scrubber.set_handler(nullptr);
+    EXPECT_EQ(before + 2, registered);
+}
+
+TEST(Scrubber, DeepChecksElements) {
+    auto &scrubber = scrub::Scrubber::instance();
+    ScrubbedStack<int, checks::WithPayload<checks::Full>> s;
+    for (int i = 0; i < 10; ++i)
+        s.push(i);
+    int *sealed = &s.top() - 1;
+    *sealed = 13;
+    EXPECT_EQ(0u, scrubber.scrub());
+    EXPECT_EQ(1u, scrubber.scrub(true));
+    *sealed = 8;
+    EXPECT_EQ(0u, scrubber.scrub(true));
+}
+
+TEST(Scrubber, BackgroundThread) {
+    auto &scrubber = scrub::Scrubber::instance();
+    std::atomic<int> reports{0};
+    scrubber.set_handler([&](const void *) { reports += 1; });
+    ASSERT_TRUE(scrub::start(std::chrono::milliseconds{1}, true));
+    EXPECT_FALSE(scrub::start(std::chrono::milliseconds{1}));
+
+    // concurrent changes are never reported
+    auto worker = [] {
+        ScrubbedStack<int, checks::WithBlocks<checks::Full, 16>> s;
+        for (int round = 0; round < 200; ++round) {
+            for (int i = 0; i < 1000; ++i)
+                s.push(i);
+            for (int i = 0; i < 1000; ++i)
+                s.pop();
+        }
+    };
+    std::thread first{worker};
+    std::thread second{worker};
+    first.join();
+    second.join();
+    EXPECT_EQ(0, reports.load());
+
+    ScrubbedStack<int> s;
+    s.push(42);
+    field(s, 0) = 0; // start canary
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds{5};
+    while (reports.load() == 0 && std::chrono::steady_clock::now() < deadline)
+        std::this_thread::sleep_for(std::chrono::milliseconds{1});
+    scrub::stop();
+    scrubber.set_handler(nullptr);
+    EXPECT_GT(reports.load(), 0);
+    EXPECT_GT(scrubber.passes(), 0u);
+    field(s, 0) = 0xDEADBEEFBADF00Dul;
+}
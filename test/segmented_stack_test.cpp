@@ -0,0 +1,196 @@
+#include "safe_stack/segmented_stack.h"
+#include "gtest/gtest.h"
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace safe_stack;
+
+namespace {
+
+template <class T, class Policy = checks::Full>
+using SmallChunks =
+    SegmentedStack<T, std::allocator<T>, Policy, logging::None,
+                   hashers::Word64, 4>;
+
+using PayloadChunks = SmallChunks<int, checks::WithPayload<checks::Full>>;
+
+} // namespace
+
+TEST(SegmentedStack, PushPop) {
+    SmallChunks<std::string> s;
+    EXPECT_THROW(s.pop(), StackUnderflow);
+    for (int i = 0; i < 100; ++i)
+        s.push(std::to_string(i));
+    EXPECT_EQ(100, s.size());
+    for (int i = 99; i >= 0; --i) {
+        EXPECT_EQ(std::to_string(i), s.top());
+        s.pop();
+    }
+    EXPECT_TRUE(s.empty());
+    EXPECT_THROW(s.top(), StackUnderflow);
+}
+
+TEST(SegmentedStack, StableReferences) {
+    SmallChunks<int> s;
+    std::vector<int *> pointers;
+    for (int i = 0; i < 100; ++i) {
+        s.push(i);
+        pointers.push_back(&s.top());
+    }
+    for (int i = 0; i < 100; ++i)
+        EXPECT_EQ(i, *pointers[i]);
+}
+
+TEST(SegmentedStack, SpareChunk) {
+    SmallChunks<int> s;
+    for (int i = 0; i < 5; ++i) // second chunk is started
+        s.push(i);
+    int *first = &s.top();
+    for (int i = 0; i < 10; ++i) {
+        s.pop();
+        s.push(i);
+        EXPECT_EQ(first, &s.top()); // the same chunk is reused
+    }
+}
+
+TEST(SegmentedStack, CopyAndMove) {
+    SmallChunks<std::string> x;
+    for (int i = 0; i < 10; ++i)
+        x.push(std::to_string(i));
+    SmallChunks<std::string> y{x};
+    EXPECT_EQ(10, y.size());
+    EXPECT_EQ("9", y.top());
+
+    SmallChunks<std::string> z{std::move(x)};
+    EXPECT_THROW(x.size(), StackInvalidState);
+    EXPECT_EQ("9", z.top());
+
+    y.pop();
+    z = y;
+    EXPECT_EQ("8", z.top());
+    y = std::move(z);
+    EXPECT_EQ(9, y.size());
+    EXPECT_THROW(z.push("1"), StackInvalidState);
+}
+
+TEST(SegmentedStack, ThrowingElement) {
+    struct Throwing {
+        explicit Throwing(int value) {
+            if (value < 0)
+                throw value;
+        }
+    };
+    SmallChunks<Throwing> s;
+    for (int i = 0; i < 4; ++i)
+        s.emplace(i);
+    EXPECT_THROW(s.emplace(-1), int);
+    EXPECT_EQ(4, s.size());
+    s.emplace(1);
+    EXPECT_EQ(5, s.size());
+}
+
+TEST(SegmentedStack, ChunkCanaries) {
+    SmallChunks<long long> s;
+    for (int i = 0; i < 4; ++i)
+        s.push(i);
+    long long *end = &s.top() + 1; // end canary of the chunk
+    long long saved = *end;
+    *end = 42;
+    EXPECT_THROW(s.size(), StackInvalidState);
+    *end = saved;
+    EXPECT_EQ(4, s.size());
+}
+
+TEST(SegmentedStack, BufferCanaries) {
+    SmallChunks<long long, checks::WithBufferCanaries<checks::HashOnly>> s;
+    for (int i = 0; i < 4; ++i)
+        s.push(i);
+    long long *end = &s.top() + 1; // end canary of the chunk
+    long long saved = std::exchange(*end, 42);
+    EXPECT_THROW(s.size(), StackInvalidState);
+    *end = saved;
+    long long *start = &s.top() - 4; // start canary of the chunk
+    saved = std::exchange(*start, 42);
+    EXPECT_THROW(s.size(), StackInvalidState);
+    *start = saved;
+    EXPECT_EQ(4, s.size());
+}
+
+TEST(SegmentedStack, LowerChunkCanaries) {
+    SmallChunks<long long> s;
+    for (int i = 0; i < 4; ++i)
+        s.push(i);
+    long long *end = &s.top() + 1; // end canary of the first chunk
+    for (int i = 4; i < 9; ++i)
+        s.push(i);
+    long long saved = std::exchange(*end, 42);
+    EXPECT_NO_THROW(s.size()); // only the top chunk is checked
+    EXPECT_THROW(s.deep_validate(), StackInvalidState);
+    *end = saved;
+    EXPECT_NO_THROW(s.deep_validate());
+}
+
+TEST(SegmentedStack, SpareChunkCanaries) {
+    SmallChunks<long long> s;
+    for (int i = 0; i < 5; ++i)
+        s.push(i);
+    long long *end = &s.top() + 4; // end canary of the chunk
+    s.pop(); // the chunk becomes the spare one
+    long long saved = std::exchange(*end, 42);
+    EXPECT_THROW(s.size(), StackInvalidState);
+    *end = saved;
+    EXPECT_EQ(4, s.size());
+}
+
+TEST(SegmentedStack, CorruptElement) {
+    PayloadChunks s;
+    std::vector<int *> pointers;
+    for (int i = 0; i < 100; ++i) {
+        s.push(i);
+        pointers.push_back(&s.top());
+    }
+    EXPECT_NO_THROW(s.deep_validate());
+    *pointers[13] = 42;
+    EXPECT_NO_THROW(s.top()); // only header is checked
+    EXPECT_THROW(s.deep_validate(), StackInvalidState);
+    *pointers[13] = 13;
+    s.top() = 42; // top element may be changed
+    EXPECT_NO_THROW(s.deep_validate());
+    SmallChunks<int, checks::WithPayload<checks::Full>> copy{s};
+    EXPECT_NO_THROW(copy.deep_validate());
+}
+
+TEST(SegmentedStack, TopChecksLastChunk) {
+    SmallChunks<int, checks::WithBlocks<checks::Full>> s;
+    std::vector<int *> pointers;
+    for (int i = 0; i < 9; ++i) {
+        s.push(i);
+        pointers.push_back(&s.top());
+    }
+    *pointers[0] = 42; // first chunk isn't checked by top()
+    EXPECT_EQ(8, s.top());
+    EXPECT_THROW(s.deep_validate(), StackInvalidState);
+    *pointers[0] = 0;
+
+    *pointers[7] = 42; // top element is alone in its chunk
+    EXPECT_THROW(s.top(), StackInvalidState);
+    *pointers[7] = 7;
+    s.pop();
+    s.pop();
+    EXPECT_NO_THROW(s.deep_validate());
+}
+
+TEST(SegmentedStack, ParanoidChecksElements) {
+    SmallChunks<int, checks::Paranoid> s;
+    std::vector<int *> pointers;
+    for (int i = 0; i < 10; ++i) {
+        s.push(i);
+        pointers.push_back(&s.top());
+    }
+    *pointers[5] = 42;
+    EXPECT_THROW(s.size(), StackInvalidState);
+    *pointers[5] = 5;
+    EXPECT_EQ(10, s.size());
+}
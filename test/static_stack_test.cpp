@@ -0,0 +1,100 @@
+#include "safe_stack/static_stack.h"
+#include "gtest/gtest.h"
+#include <cstdint>
+#include <string>
+
+using namespace safe_stack;
+
+namespace {
+
+/// Evaluates expression in reverse Polish notation (digits, '+' and '*').
+template <class Policy>
+constexpr int evaluate(const char *expression) {
+    StaticStack<int, 16, Policy> s;
+    for (auto c = expression; *c != '\0'; ++c) {
+        if (*c >= '0' && *c <= '9') {
+            if (s.push(*c - '0') != Status::ok)
+                return -1;
+            continue;
+        }
+        auto top = s.top();
+        if (top == nullptr)
+            return -1;
+        int right = *top;
+        if (s.pop() != Status::ok || (top = s.top()) == nullptr)
+            return -1;
+        *top = *c == '+' ? *top + right : *top * right;
+    }
+    return s.size() == 1 ? *s.top() : -1;
+}
+
+static_assert(evaluate<checks::Full>("23+4*") == 20);
+static_assert(evaluate<checks::Paranoid>("12+3+45**") == 120);
+static_assert(evaluate<checks::Full>("+") == -1);
+
+// checksum of the elements takes no space if it is disabled
+static_assert(sizeof(StaticStack<int, 4>) + sizeof(std::uint64_t) ==
+              sizeof(StaticStack<int, 4, checks::WithPayload<checks::Full>>));
+
+template <class Stack>
+unsigned long long &field(Stack &s, std::size_t index) {
+    return reinterpret_cast<unsigned long long *>(&s)[index];
+}
+
+} // namespace
+
+TEST(StaticStack, PushPop) {
+    StaticStack<std::string, 4> s;
+    EXPECT_EQ(Status::underflow, s.pop());
+    EXPECT_EQ(nullptr, s.top());
+    for (int i = 0; i < 4; ++i)
+        EXPECT_EQ(Status::ok, s.push(std::to_string(i)));
+    EXPECT_EQ(Status::overflow, s.push("4"));
+    EXPECT_EQ(4, s.size());
+    for (int i = 3; i >= 0; --i) {
+        EXPECT_EQ(std::to_string(i), *s.top());
+        EXPECT_EQ(Status::ok, s.pop());
+    }
+    EXPECT_TRUE(s.empty());
+}
+
+TEST(StaticStack, Corruption) {
+    StaticStack<int, 4> s;
+    EXPECT_EQ(Status::ok, s.push(1));
+    field(s, 0) = 0; // start canary
+    EXPECT_FALSE(s.valid());
+    EXPECT_EQ(Status::invalid_state, s.push(2));
+    EXPECT_EQ(Status::invalid_state, s.pop());
+    EXPECT_EQ(nullptr, s.top());
+    field(s, 0) = 0xDEADBEEFBADF00Dul;
+    EXPECT_EQ(1, *s.top());
+
+    field(s, 3) += 1; // size
+    EXPECT_EQ(Status::invalid_state, s.clear());
+    field(s, 3) -= 1;
+    EXPECT_EQ(Status::ok, s.clear());
+}
+
+TEST(StaticStack, Payload) {
+    StaticStack<int, 8, checks::WithPayload<checks::Full>> s;
+    for (int i = 0; i < 8; ++i)
+        EXPECT_EQ(Status::ok, s.push(i));
+    *s.top() = 42; // top element may be changed
+    EXPECT_EQ(Status::ok, s.deep_validate());
+    int *elements = s.top() - 7;
+    elements[2] = 42;
+    EXPECT_TRUE(s.valid()); // only fields are checked
+    EXPECT_EQ(Status::invalid_state, s.deep_validate());
+    elements[2] = 2;
+    EXPECT_EQ(Status::ok, s.pop());
+    EXPECT_EQ(Status::ok, s.deep_validate());
+}
+
+TEST(StaticStack, CopyIsIndependent) {
+    StaticStack<int, 4> x;
+    EXPECT_EQ(Status::ok, x.push(1));
+    auto y = x;
+    EXPECT_EQ(Status::ok, y.push(2));
+    EXPECT_EQ(1, x.size());
+    EXPECT_EQ(2, *y.top());
+}
@@ -0,0 +1,119 @@
+#include "safe_stack/safe_stack.h"
+#include "safe_stack/trace.h"
+#include "gtest/gtest.h"
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+using namespace safe_stack;
+
+namespace {
+
+template <class T>
+using TracedStack = Stack<T, std::allocator<T>, checks::Full, trace::Logger>;
+
+} // namespace
+
+TEST(Trace, StoppedTracerIgnoresEvents) {
+    TracedStack<int> s;
+    s.push(42);
+    s.pop();
+    EXPECT_EQ(0u, trace::Tracer::instance().dropped());
+}
+
+TEST(Trace, WriteAndRead) {
+    auto path = testing::TempDir() + "safe_stack_trace.bin";
+    ASSERT_TRUE(trace::start(path));
+    EXPECT_FALSE(trace::start(path));
+
+    auto worker = [] {
+        TracedStack<int> s;
+        for (int i = 0; i < 100; ++i)
+            s.push(i);
+    };
+    std::thread first{worker};
+    std::thread second{worker};
+    first.join();
+    second.join();
+    trace::stop();
+
+    std::vector<trace::TraceRecord> records;
+    ASSERT_TRUE(trace::read(path, records));
+    EXPECT_EQ(0u, trace::Tracer::instance().dropped());
+
+    std::size_t pushes = 0;
+    for (auto &record : records) {
+        if (record.op == logging::Op::push) {
+            ++pushes;
+            EXPECT_GE(record.capacity, record.size);
+        }
+    }
+    EXPECT_EQ(200u, pushes);
+
+    // events of one thread are in order
+    std::vector<trace::TraceRecord> thread;
+    for (auto &record : records)
+        if (record.thread == records.front().thread)
+            thread.push_back(record);
+    EXPECT_EQ(logging::Op::construct, thread.front().op);
+    EXPECT_EQ(logging::Op::push, thread[thread.size() - 2].op);
+    EXPECT_EQ(100u, thread[thread.size() - 2].size);
+    EXPECT_EQ(logging::Op::destroy, thread.back().op);
+    for (std::size_t i = 1; i < thread.size(); ++i)
+        EXPECT_LE(thread[i - 1].timestamp, thread[i].timestamp);
+}
+
+TEST(Trace, WrongFile) {
+    std::vector<trace::TraceRecord> records;
+    EXPECT_FALSE(trace::read(testing::TempDir() + "no_such_trace", records));
+}
+
+TEST(Trace, BuffersOfExitedThreadsAreRemoved) {
+    auto path = testing::TempDir() + "safe_stack_churn.bin";
+    ASSERT_TRUE(trace::start(path));
+    for (int i = 0; i < 16; ++i) {
+        std::thread{[i] {
+            TracedStack<int> s;
+            s.push(i);
+        }}.join();
+    }
+    trace::stop();
+    // only the main thread's buffer may stay
+    EXPECT_LE(trace::Tracer::instance().buffers(), 1u);
+
+    std::vector<trace::TraceRecord> records;
+    ASSERT_TRUE(trace::read(path, records));
+    EXPECT_EQ(16u * 4, records.size()); // construct, reserve, push, destroy
+    for (auto &record : records)
+        for (auto byte : record.reserved)
+            EXPECT_EQ(0, byte);
+}
+
+TEST(Trace, EventsDuringStopStayInTheirSession) {
+    auto first = testing::TempDir() + "safe_stack_first.bin";
+    auto second = testing::TempDir() + "safe_stack_second.bin";
+    std::atomic<bool> done{false};
+    auto worker = [&] {
+        TracedStack<int> s;
+        while (!done.load()) {
+            s.push(1);
+            s.pop();
+        }
+    };
+    ASSERT_TRUE(trace::start(first));
+    std::vector<std::thread> workers;
+    for (int i = 0; i < 4; ++i)
+        workers.emplace_back(worker);
+    std::this_thread::sleep_for(std::chrono::milliseconds{5});
+    trace::stop(); // workers record events until the end of stop()
+    done = true;
+    for (auto &thread : workers)
+        thread.join();
+
+    ASSERT_TRUE(trace::start(second));
+    trace::stop();
+    std::vector<trace::TraceRecord> records;
+    ASSERT_TRUE(trace::read(second, records));
+    EXPECT_EQ(0u, records.size());
+}
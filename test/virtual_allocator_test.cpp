@@ -0,0 +1,63 @@
+#include "safe_stack/safe_stack.h"
+#include "safe_stack/virtual_allocator.h"
+#include "gtest/gtest.h"
+#include <string>
+#include <vector>
+
+using namespace safe_stack;
+
+namespace {
+
+template <class T, class Policy = checks::Full>
+using VirtualStack = Stack<T, VirtualAllocator<T>, Policy>;
+
+} // namespace
+
+TEST(VirtualAllocator, StableReferences) {
+    VirtualStack<std::string> s;
+    std::vector<const std::string *> pointers;
+    for (int i = 0; i < 10000; ++i) {
+        s.push(std::to_string(i));
+        pointers.push_back(&s.top());
+    }
+    for (int i = 0; i < 10000; ++i)
+        EXPECT_EQ(std::to_string(i), *pointers[i]);
+    for (int i = 9999; i >= 0; --i) {
+        EXPECT_EQ(pointers[i], &s.top()); // shrinking doesn't move too
+        s.pop();
+    }
+}
+
+TEST(VirtualAllocator, BlockChecksums) {
+    VirtualStack<int, checks::WithBlocks<checks::Full>> s;
+    for (int i = 0; i < 100000; ++i)
+        s.push(i);
+    EXPECT_NO_THROW(s.deep_validate());
+    for (int i = 0; i < 90000; ++i)
+        s.pop();
+    EXPECT_NO_THROW(s.deep_validate());
+    VirtualStack<int, checks::WithBlocks<checks::Full>> copy{s};
+    EXPECT_NO_THROW(copy.deep_validate());
+    EXPECT_EQ(9999, copy.top());
+}
+
+TEST(VirtualAllocator, TooBig) {
+    VirtualAllocator<int, 1 << 20> allocator;
+    EXPECT_THROW(allocator.allocate(1 << 20), std::bad_alloc);
+    auto p = allocator.allocate(10);
+    EXPECT_THROW(allocator.resize(p, 10, 1 << 20), std::bad_alloc);
+    allocator.deallocate(p, 10);
+}
+
+TEST(VirtualAllocatorDeathTest, WritePastCommitted) {
+    VirtualAllocator<int> allocator;
+    auto n = detail::page_size() / sizeof(int);
+    auto p = allocator.allocate(n);
+    p[n - 1] = 42;
+    EXPECT_DEATH(p[n] = 42, "");
+    allocator.resize(p, n, 2 * n);
+    p[n] = 42;
+    allocator.resize(p, 2 * n, n); // page is released
+    EXPECT_DEATH(p[n] = 42, "");
+    allocator.deallocate(p, n);
+}